@@ -0,0 +1,110 @@
+/*
+ * Host benchmark for the flush planner of the graphics library.
+ *
+ * Recorded workloads (the drawing done between two calls of graphics_show on a
+ * dashboard style display) are drawn in the framebuffer, and the estimated
+ * cost of each plan is printed together with the plan that the planner chooses.
+ * The costs are in the time it takes to send one byte on the bus, with the cost
+ * model in the framebuffer config file.
+ *
+ * Copyright (c) 2021. BlueZephyr
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ *
+ */
+
+#include <stdio.h>
+#include "framebuffer.h"
+#include "flush_planner.h"
+
+#define MAX_RECTS   8u
+
+/*
+ * Filled rectangle in pixels
+ */
+struct rect_t
+{
+    uint8_t x;
+    uint8_t y;
+    uint8_t width;
+    uint8_t height;
+};
+
+struct workload_t
+{
+    const char *name;
+    uint8_t rectCount;
+    struct rect_t rects[MAX_RECTS];
+};
+
+static const struct workload_t workloads[] =
+{
+    {"clock tick (2 digits)", 1, {{104, 0, 12, 8}}},
+    {"clock + status icon", 2, {{92, 0, 36, 8}, {0, 56, 8, 8}}},
+    {"progress bar step", 1, {{10, 44, 4, 6}}},
+    {"text line redrawn", 1, {{0, 24, 128, 8}}},
+    {"menu highlight moved", 2, {{0, 16, 80, 8}, {0, 32, 80, 8}}},
+    {"staircase of labels", 6, {{0, 0, 12, 7}, {20, 8, 12, 7}, {40, 16, 12, 7},
+                                {60, 24, 12, 7}, {80, 32, 12, 7}, {100, 40, 12, 7}}},
+    {"scattered sparks", 8, {{3, 5, 1, 1}, {120, 9, 1, 1}, {64, 30, 1, 1}, {17, 50, 1, 1},
+                             {90, 60, 1, 1}, {40, 20, 1, 1}, {110, 40, 1, 1}, {5, 35, 1, 1}}},
+    {"two graphs updated", 2, {{0, 8, 60, 40}, {68, 8, 60, 40}}},
+    {"full screen animation", 1, {{0, 0, 128, 64}}},
+};
+
+static const char * const planNames[FLUSH_PLANS] =
+{
+    "dirty areas",
+    "page spans",
+    "bounding box",
+    "full frame"
+};
+
+static void drawWorkload(const struct workload_t *workload)
+{
+    framebuffer_clearDirty();
+    for (uint8_t i=0; i<workload->rectCount; i++)
+    {
+        const struct rect_t *rect = &workload->rects[i];
+
+        for (uint16_t x=rect->x; x<rect->x + rect->width; x++)
+        {
+            for (uint16_t y=rect->y; y<rect->y + rect->height; y++)
+            {
+                framebuffer_setPixel(x, y);
+            }
+        }
+    }
+}
+
+int main(void)
+{
+    struct framebuffer_area_t areas[FLUSH_PLANNER_MAX_AREAS];
+    uint8_t count;
+
+    framebuffer_init();
+    printf("%-24s", "workload");
+    for (uint8_t plan=0; plan<FLUSH_PLANS; plan++)
+    {
+        printf(" %13s", planNames[plan]);
+    }
+    printf("   chosen\n");
+
+    for (uint8_t i=0; i<sizeof(workloads)/sizeof(workloads[0]); i++)
+    {
+        enum flush_plan_t chosen;
+
+        drawWorkload(&workloads[i]);
+        flush_planner_init();
+        printf("%-24s", workloads[i].name);
+        for (uint8_t plan=0; plan<FLUSH_PLANS; plan++)
+        {
+            count = flush_planner_getAreas((enum flush_plan_t)plan, areas);
+            printf(" %13u", flush_planner_getCost(areas, count));
+        }
+        chosen = flush_planner_plan(areas, &count);
+        printf("   %s (%u areas)\n", planNames[chosen], count);
+    }
+    return 0;
+}
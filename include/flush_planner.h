@@ -0,0 +1,78 @@
+/*
+ * Flush planner for the graphics library.
+ *
+ * The planner decides how the modified parts of the framebuffer are sent to the
+ * display. Each area that is sent costs a window change (the column and page
+ * address commands) and a transaction start for each chunk of data, on top of
+ * the data itself. The planner makes the areas of each plan, estimates the bus
+ * time of each plan with a cost model (see FLUSH_COST_WINDOW and
+ * FLUSH_COST_TRANSFER in the framebuffer config file), and chooses the plan with
+ * the lowest cost. The plans are:
+ *  - The dirty areas of the framebuffer (see framebuffer_getDirtyAreas).
+ *  - The modified columns of each page (see framebuffer_getDirtySpan).
+ *  - The bounding box of all modifications.
+ *  - The full frame.
+ * In the first two plans, areas are merged when the merged area is cheaper to
+ * send than the areas on their own. The areas of a plan do not overlap, so the
+ * parts of other areas that a merged area covers are not sent again.
+ *
+ * Copyright (c) 2021. BlueZephyr
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ *
+ */
+
+#ifndef BITLOOM_FLUSH_PLANNER_H
+#define BITLOOM_FLUSH_PLANNER_H
+
+#include <stdint.h>
+#include "framebuffer.h"
+
+/*
+ * Max number of areas in a plan. The areas parameter of the functions must
+ * have room for this many areas.
+ */
+#define FLUSH_PLANNER_PAGES ((FRAMEBUFFER_Y_PIXELS + 7u) / 8u)
+#if (FRAMEBUFFER_DIRTY_AREAS > FLUSH_PLANNER_PAGES)
+#define FLUSH_PLANNER_MAX_AREAS FRAMEBUFFER_DIRTY_AREAS
+#else
+#define FLUSH_PLANNER_MAX_AREAS FLUSH_PLANNER_PAGES
+#endif
+
+enum flush_plan_t
+{
+    flush_plan_dirty_areas,
+    flush_plan_page_spans,
+    flush_plan_bounding_box,
+    flush_plan_full_frame
+};
+
+#define FLUSH_PLANS     4u
+
+/*
+ * Init the planner. Must be called before the planner is used.
+ */
+void flush_planner_init(void);
+
+/*
+ * Choose the cheapest plan to send the modified parts of the framebuffer. The
+ * areas of the plan are copied to the areas parameter, and the number of areas
+ * is written to areaCount. Must only be called if the framebuffer is "dirty".
+ */
+enum flush_plan_t flush_planner_plan(struct framebuffer_area_t *areas, uint8_t *areaCount);
+
+/*
+ * Make the areas of a plan. Returns the number of areas.
+ */
+uint8_t flush_planner_getAreas(enum flush_plan_t plan, struct framebuffer_area_t *areas);
+
+/*
+ * Estimated cost (in the time it takes to send a byte on the bus) to send the
+ * areas. The window change of the first area is free if the area is the same as
+ * the last area of the previous plan, since the display is then already at the
+ * start of the window (not with page flipping, where the window moves).
+ */
+uint16_t flush_planner_getCost(const struct framebuffer_area_t *areas, uint8_t count);
+
+#endif //BITLOOM_FLUSH_PLANNER_H
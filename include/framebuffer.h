@@ -15,6 +15,17 @@
 #include <stdbool.h>
 #include "config/framebuffer_config.h"
 
+/*
+ * Area of the framebuffer in segments (x in pixels, y in lines of segments).
+ */
+struct framebuffer_area_t
+{
+    uint8_t xStart;
+    uint8_t xEnd;
+    uint8_t yStart;
+    uint8_t yEnd;
+};
+
 /*
  * Init the framebuffer. This function must be called before any of the
  * framebuffer functions are used.
@@ -34,17 +45,24 @@ void framebuffer_init (void);
 uint8_t* framebuffer_getDirtyAreaBuffer (uint8_t *yStartSeg, uint16_t *bufferLen);
 
 /*
- * Function to lock and unlock the framebuffer.
+ * Function to lock and unlock the framebuffer. The lock is kept per line of
+ * segments (page of the display). framebuffer_lock locks all lines, and
+ * framebuffer_unlockLines unlocks the lines in the lines parameter (bit n is
+ * line n), e.g., when they have been sent to the display.
  */
 void framebuffer_lock(void);
 void framebuffer_unlock(void);
+void framebuffer_unlockLines(uint32_t lines);
 
 /*
  * Function to query the framebuffer if a show request has been made. If so,
- * it is not available for modifications. Calls to to functions that modifies
- * the framebuffer when the show request is being processed are not allowed.
+ * it is not available for modifications. The drawing functions do not modify
+ * the lines that are locked and return false instead. framebuffer_isLocked
+ * returns true if any line is locked, and framebuffer_isLineLocked if the
+ * specified line (in segments) is locked.
  */
 bool framebuffer_isLocked (void);
+bool framebuffer_isLineLocked (uint8_t ySeg);
 
 /*
  * Function to check if the framebuffer is "dirty", i.e., it has modifications
@@ -52,6 +70,12 @@ bool framebuffer_isLocked (void);
  */
 bool framebuffer_isDirty (void);
 
+/*
+ * Function to mark the framebuffer as not "dirty", e.g., when the dirty area
+ * has been handed over to the display driver.
+ */
+void framebuffer_clearDirty (void);
+
 /*
  * Function to get the actual area to be updated. The values are only valid if
  * the framebuffer is "dirty". Note that the values are in segments.
@@ -59,6 +83,36 @@ bool framebuffer_isDirty (void);
 void framebuffer_getDirtyArea (uint8_t* xStartSeg, uint8_t* xEndSeg,
                                uint8_t* yStartSeg, uint8_t* yEndSeg);
 
+/*
+ * Function to get the modified parts of the framebuffer as separate areas. The
+ * areas do not overlap, and their union is within the area returned by
+ * framebuffer_getDirtyArea. Areas that overlap or touch are merged, and when
+ * there are more than FRAMEBUFFER_DIRTY_AREAS (see the config file), the areas
+ * that add the fewest segments are merged. The areas are copied to the areas
+ * parameter, which must have room for FRAMEBUFFER_DIRTY_AREAS areas, and the
+ * number of areas is returned. The values are only valid if the framebuffer is
+ * "dirty".
+ */
+uint8_t framebuffer_getDirtyAreas (struct framebuffer_area_t *areas);
+
+/*
+ * Function to get the columns (in pixels) that have been modified on a line of
+ * segments (a page of the display). Returns false if nothing on the line has
+ * been modified. The values are only valid if the framebuffer is "dirty".
+ */
+bool framebuffer_getDirtySpan (uint8_t ySeg, uint8_t *xStartSeg, uint8_t *xEndSeg);
+
+#if (FRAMEBUFFER_DOUBLE_BUFFER)
+/*
+ * Double buffering. The drawing functions write to the back buffer, and the data
+ * that is sent to the display is read from the front buffer. The function copies
+ * the modified columns of each line (see framebuffer_getDirtySpan) from the back
+ * buffer to the front buffer, which then holds the same frame as the back buffer.
+ * The front buffer must not be sent to the display at the same time.
+ */
+void framebuffer_copyToFront (void);
+#endif
+
 /*
  * Function to extract the data on the framebuffer that shall be sent to the
  * display. Note that only modified parts of the display are considered; other
@@ -78,24 +132,37 @@ void framebuffer_getDirtyArea (uint8_t* xStartSeg, uint8_t* xEndSeg,
  */
 uint16_t framebuffer_copyDirtyArea (uint8_t* buffer, uint16_t bufferLen);
 
+/*
+ * Function to get a pointer to the segment at the specified position (in
+ * segments) in the framebuffer. The rest of the segments on the same line
+ * follow directly after it. The pointer can be used to send a part of a line
+ * to the display without copying it, e.g., with ssd1306_sendGraphicsSpans.
+ * With FRAMEBUFFER_DOUBLE_BUFFER, the pointer is to the front buffer.
+ */
+const uint8_t* framebuffer_getSegments (uint8_t xSeg, uint8_t ySeg);
+
 
 /*
  * Functions to set or clear a pixel in the framebuffer. The position is
  * specified with the xPos and yPos parameters (in pixels). The functions
  * will update the framebuffer data and modify the "dirty" state of the
- * framebuffer accordingly. The framebuffer_getPixel function will return the state of
- * the specified pixel without making any modifications on the framebuffer.
+ * framebuffer accordingly. They return false, without modifying the
+ * framebuffer, if the line of the pixel is locked. The framebuffer_getPixel
+ * function will return the state of the specified pixel without making any
+ * modifications on the framebuffer.
  */
-void framebuffer_setPixel (uint8_t xPos, uint8_t yPos);
-void framebuffer_clearPixel (uint8_t xPos, uint8_t yPos);
+bool framebuffer_setPixel (uint8_t xPos, uint8_t yPos);
+bool framebuffer_clearPixel (uint8_t xPos, uint8_t yPos);
 uint8_t framebuffer_getPixel (uint8_t xPos, uint8_t yPos);
 
 
 /*
  * Blit function
  *
- * Sizes and position in pixels. Data in segments.
+ * Sizes and position in pixels. Data in segments. Returns false, without
+ * modifying the framebuffer, if any of the lines that the object covers is
+ * locked.
  */
-void framebuffer_blit (int8_t x, int8_t y, uint8_t width, uint8_t height, const uint8_t* data);
+bool framebuffer_blit (int16_t x, int8_t y, uint8_t width, uint8_t height, const uint8_t* data);
 
 #endif // FRAMEBUFFER_H
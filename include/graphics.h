@@ -1,42 +1,61 @@
-/*
- * Graphics library for small, monochrome displays (max size 255*255 pixels)
- *
- * The graphics library provides a set of functions to draw graphics on a display.
- * It uses a framebuffer to keep a representation of the display contents in RAM.
- * Calls to the graphics functions will manipulate the contents of the framebuffer
- * but the data will not be sent to the display until the 'show' function is called.
- * When the 'show' function is called, this is an indication to the library to
- * start sending the framebuffer data to the display. The sending is done by the
- * run function (called by the scheduler). During the transmission of the bitmap
- * data to the display, the framebuffer is locked for modifications. As soon as
- * the contents has been sent, new data can be put in the framebuffer again.
- *
- * Copyright (c) 2015-2021. BlueZephyr
- */
-
-#ifndef BITLOOM_GRAPHICS_H
-#define BITLOOM_GRAPHICS_H
-
-#include <stdbool.h>
-#include <stdint.h>
-
-/*
- * Init the graphics library. This function must be called before any of the
- * graphics functions can be used.
- */
-void graphics_init(uint8_t taskId);
-
-/*
- * Run function for the task. Called by the scheduler.
- */
-void graphics_run (void);
-
-/*
- * Function to indicate that the drawing on the framebuffer is finished and
- * that the updated contents shall be sent to the display. The function will
- * lock the framebuffer for further modifications. When all data has been sent,
- * the framebuffer will be unlocked for further modifications.
- */
-void graphics_show (void);
-
-#endif //BITLOOM_GRAPHICS_H
+/*
+ * Graphics library for small, monochrome displays (max size 255*255 pixels)
+ *
+ * The graphics library provides a set of functions to draw graphics on a display.
+ * It uses a framebuffer to keep a representation of the display contents in RAM.
+ * Calls to the graphics functions will manipulate the contents of the framebuffer
+ * but the data will not be sent to the display until the 'show' function is called.
+ * When the 'show' function is called, this is an indication to the library to
+ * start sending the framebuffer data to the display. The sending is done by the
+ * run function (called by the scheduler). During the transmission of the bitmap
+ * data to the display, the framebuffer is locked for modifications. The lock is
+ * kept per line of segments (page of the display): lines that are not part of
+ * the frame, and lines that have been sent, are unlocked while the rest of the
+ * frame is sent. Drawing calls that touch a locked line return false and can be
+ * made again later. As soon as the contents has been sent, the whole
+ * framebuffer is unlocked again.
+ *
+ * With FRAMEBUFFER_DOUBLE_BUFFER in the framebuffer config file, the framebuffer
+ * is not locked. The modified parts are copied to a front buffer when the frame
+ * is started, and the data is sent from there while the next frame is drawn.
+ * A show request made while a frame is sent is handled when the frame is done.
+ *
+ * The framebuffer can span several panels placed side by side (GRAPHICS_PANELS
+ * in the framebuffer config file). Panel n is SSD1306 display n, so the displays
+ * must be added with ssd1306_addDisplay before the graphics task is run. The
+ * part of the dirty area on each panel is sent to that panel only, and the
+ * transfers to the panels run at the same time.
+ *
+ * Copyright (c) 2015-2021. BlueZephyr
+ */
+
+#ifndef BITLOOM_GRAPHICS_H
+#define BITLOOM_GRAPHICS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Init the graphics library. This function must be called before any of the
+ * graphics functions can be used.
+ */
+void graphics_init(uint8_t taskId);
+
+/*
+ * Run function for the task. Called by the scheduler. The requests are made to
+ * each panel without changing the display that is selected in the SSD1306
+ * driver (see ssd1306_selectDisplay).
+ */
+void graphics_run (void);
+
+/*
+ * Function to indicate that the drawing on the framebuffer is finished and
+ * that the updated contents shall be sent to the display. The function will
+ * lock the framebuffer for further modifications. The lines are unlocked as
+ * they have been sent, and when all data has been sent, the framebuffer will be
+ * unlocked for further modifications. The framebuffer is not locked if it is
+ * double buffered.
+ */
+void graphics_show (void);
+
+#endif //BITLOOM_GRAPHICS_H
@@ -2,7 +2,8 @@
  * Simple driver for the HMC5883L 3-Axis digital compass IC.
  *
  * Note that the driver does not have its own task. All functions are carried
- * out by calls to the underlying I2C driver. This means that, after each
+ * out by calls to the underlying I2C driver, through the I2C bus arbiter (see
+ * i2c_arbiter.h). This means that, after each
  * function call, the application has to wait for the driver to become ready
  * (use the hmc_driver_status function) before the next function is called.
  *
@@ -0,0 +1,87 @@
+/*
+ * Arbiter for a shared I2C bus.
+ *
+ * The drivers that share the I2C bus submit their transactions to the arbiter
+ * instead of calling the I2C driver directly. The arbiter does not have its
+ * own task. Each request is either forwarded to the I2C driver directly or
+ * rejected with i2c_request_busy, in which case the client shall retry the
+ * request in a later call of its run function (as it does when the I2C driver
+ * itself is busy).
+ *
+ * When several clients compete for the bus, the bus is granted in order of:
+ *  1. Clients that have been rejected at least I2C_ARBITER_LATENCY_BOUND times
+ *     in a row (the latency bound is exceeded).
+ *  2. Clients with higher priority.
+ *  3. Clients that have been waiting longer.
+ * A client that has been rejected keeps a reservation of the bus until it has
+ * been granted, or until it cancels the request (see i2c_arbiter_cancel). This
+ * way a small periodic sensor read is not delayed by more than one transfer of
+ * a bulk data client with lower priority.
+ *
+ * Copyright (c) 2021. BlueZephyr
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ *
+ */
+
+#ifndef BITLOOM_DRIVERS_I2C_ARBITER_H
+#define BITLOOM_DRIVERS_I2C_ARBITER_H
+
+#include <stdint.h>
+#include "hal/i2c.h"
+#include "config/i2c_arbiter_config.h"
+
+/*
+ * Returned by i2c_arbiter_addClient if no more clients can be added.
+ */
+#define I2C_ARBITER_NO_CLIENT   0xFFu
+
+/*
+ * Initialize the arbiter. Must be called once at startup, before the drivers
+ * that use the arbiter are initialized. All clients are removed.
+ */
+void i2c_arbiter_init(void);
+
+/*
+ * Add a client of the bus. A higher value of the priority means a higher
+ * priority. The function returns the id to use for the client's requests, or
+ * I2C_ARBITER_NO_CLIENT if I2C_ARBITER_MAX_CLIENTS clients have been added
+ * already. Requests from I2C_ARBITER_NO_CLIENT are rejected while an operation
+ * is processing, but do not take part in the reservations.
+ */
+uint8_t i2c_arbiter_addClient(uint8_t priority);
+
+/*
+ * Remove a client of the bus, e.g. when the driver is initialized again. The
+ * reservation of the client is cancelled and the id may be returned by
+ * i2c_arbiter_addClient again.
+ */
+void i2c_arbiter_removeClient(uint8_t client);
+
+/*
+ * Cancel the reservation of a client that no longer makes the rejected request,
+ * e.g. when the operation has been given up. Otherwise the reservation would
+ * hold back the other clients.
+ */
+void i2c_arbiter_cancel(uint8_t client);
+
+/*
+ * Request functions. The parameters are the same as for the corresponding
+ * functions in the I2C driver. The result parameter is also used by the
+ * arbiter to determine when the bus is free again.
+ */
+enum i2c_request_t
+i2c_arbiter_transmit(uint8_t client, uint8_t address, const uint8_t *buffer,
+                     uint16_t length, enum i2c_op_result_t *result);
+
+enum i2c_request_t
+i2c_arbiter_transmitRegister(uint8_t client, uint8_t address, uint8_t reg,
+                             const uint8_t *buffer, uint16_t length,
+                             enum i2c_op_result_t *result);
+
+enum i2c_request_t
+i2c_arbiter_readRegister(uint8_t client, uint8_t address, uint8_t read_register,
+                         uint8_t *buffer, uint16_t length, enum i2c_op_result_t *result);
+
+#endif //BITLOOM_DRIVERS_I2C_ARBITER_H
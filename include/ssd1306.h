@@ -21,18 +21,50 @@
  * for the requested commandType. If the returned value is "ssd1306_request_ok", the
  * the commandType will be processed and the result will be published in the "result"
  * out parameter of the function.
+ *
+ * The commands are put in a queue (see SSD1306_COMMAND_QUEUE_SIZE in the config
+ * file) and "ssd1306_request_busy" is only returned when the queue is full. Queued
+ * commands are sent in order, and commands that are queued back-to-back are sent
+ * to the display in the same transaction. The result parameter of each command is
+ * set to "ssd1306_result_processing" when it is queued. Commands that are queued
+ * while graphics data is sent are held back until the transfer is done, so that
+ * they do not take effect in the middle of a frame.
+ *
+ * Commands with parameters outside the allowed range are rejected with
+ * "ssd1306_request_invalid".
+ *
+ * A transfer that fails on the bus is sent again (see SSD1306_RETRY_LIMIT in the
+ * config file). Graphics data is resumed at the last data that the display has
+ * received. If the transfer still fails, the result is set to
+ * "ssd1306_result_error".
  */
 
 enum ssd1306_request_t
 {
     ssd1306_request_ok,
-    ssd1306_request_busy
+    ssd1306_request_busy,
+    ssd1306_request_invalid
 };
 
 enum ssd1306_result_t
 {
     ssd1306_result_ok,
-    ssd1306_result_processing
+    ssd1306_result_processing,
+    ssd1306_result_error
+};
+
+/*
+ * Bus error statistics for a display. A transfer that did not start is one that
+ * the display never received (start or address error on I2C). An interrupted
+ * transfer has failed after the display may have received a part of it.
+ */
+struct ssd1306_statistics_t
+{
+    uint16_t notStartedErrors;
+    uint16_t interruptedErrors;
+    uint16_t retries;
+    uint16_t resumes;
+    uint16_t failures;
 };
 
 /*
@@ -42,19 +74,90 @@ enum ssd1306_result_t
 void ssd1306_init(uint8_t taskId);
 
 /*
- * Function to run the SSD1306 task. Called by the scheduler.
+ * Function to run the SSD1306 task. Called by the scheduler. The displays are
+ * run in turn, and the display that is run first changes for each call, so the
+ * transfers to the displays are interleaved.
  */
 void ssd1306_run(void);
 
+/*
+ * Returned by ssd1306_addDisplay if the display could not be added.
+ */
+#define SSD1306_NO_DISPLAY      0xFFu
+
+/*
+ * The driver can handle several displays (see SSD1306_MAX_DISPLAYS in the config
+ * file). Each display has its own address, geometry, state and command queue.
+ * The init function adds the display in the config file as display 0. More
+ * displays are added with ssd1306_addDisplay, which returns the number of the
+ * new display or SSD1306_NO_DISPLAY if no more displays can be added or if the
+ * geometry does not fit in the display RAM.
+ *
+ * The address is the I2C address of the display, or the SPI device (chip
+ * select) if the displays are connected over SPI. The D/C line (see
+ * ssd1306_setDataCommandLine) is shared by the displays, so on SPI the
+ * transfers to the displays are made one at a time. On I2C, they are
+ * interleaved by the bus arbiter. The width, height and column offset are the
+ * same as SSD1306_WIDTH, SSD1306_HEIGHT and SSD1306_COLUMN_OFFSET in the config
+ * file.
+ */
+uint8_t ssd1306_addDisplay(uint8_t address, uint8_t width, uint8_t height, uint8_t columnOffset);
+
+/*
+ * Select the display that the following requests are made to. Display 0 is
+ * selected after init. Returns false if there is no such display.
+ *
+ * Each request function also has a variant with the suffix "On" that takes the
+ * display as the first parameter, e.g. ssd1306_setContrastOn(display, ...). It
+ * makes the request to that display and leaves the selection as it is, and
+ * returns "ssd1306_request_invalid" if there is no such display. The selection
+ * is shared by all users of the driver, so a module that makes requests to
+ * several displays, such as the graphics library, shall use the variants.
+ */
+bool ssd1306_selectDisplay(uint8_t display);
+
+/*
+ * Get the display that is selected.
+ */
+uint8_t ssd1306_getSelectedDisplay(void);
+
+/*
+ * Get the time when the driver has to run next. Returns true if all displays
+ * that have work to do wait for the power on delay (see ssd1306_initDisplay),
+ * and sets "time" to the end of the first delay. The run function does not
+ * need to be called before then, unless new requests are made. The time is in
+ * milliseconds from the timer in bitloom-core (timer_getMilliseconds).
+ */
+bool ssd1306_getWakeupTime(uint32_t *time);
+
+/*
+ * Get the bus error statistics for the selected display.
+ */
+void ssd1306_getStatistics(struct ssd1306_statistics_t *statistics);
+
+/*
+ * Function to control the D/C line of the display. Only used when the display
+ * is connected over 4-wire SPI (SSD1306_BUS set to SSD1306_BUS_SPI in the config
+ * file) and must then be implemented by the application. The line shall be set
+ * high if "data" is true (graphics data) and low otherwise (commands). The driver
+ * calls the function before each transfer is started, and only when no transfer
+ * to any of the displays is in progress.
+ */
+void ssd1306_setDataCommandLine(bool data);
+
 /*
  * COMMANDS
  */
 
 /*
  * Function to initialize the OLED display. The function uses the values in the
- * config file to configure the display.
+ * config file to configure the display. The init sequence is sent when
+ * SSD1306_POWER_ON_DELAY_MS (see the config file) has passed since the request.
+ * With SSD1306_GDDRAM_SHADOW, the content of the display RAM is no longer known
+ * after the request, so all graphics data is sent again.
  */
 enum ssd1306_request_t ssd1306_initDisplay(enum ssd1306_result_t *result);
+enum ssd1306_request_t ssd1306_initDisplayOn(uint8_t display, enum ssd1306_result_t *result);
 
 /*
  * FUNDAMENTAL COMMANDS
@@ -65,6 +168,7 @@ enum ssd1306_request_t ssd1306_initDisplay(enum ssd1306_result_t *result);
  * Default value is 0x7F
  */
 enum ssd1306_request_t ssd1306_setContrast(uint8_t level, enum ssd1306_result_t *result);
+enum ssd1306_request_t ssd1306_setContrastOn(uint8_t display, uint8_t level, enum ssd1306_result_t *result);
 
 /*
  * Select if the pixels are set based on the contents of the display's internal
@@ -73,26 +177,145 @@ enum ssd1306_request_t ssd1306_setContrast(uint8_t level, enum ssd1306_result_t
  * Default value is to base on RAM
  */
 enum ssd1306_request_t ssd1306_setPixelsFromRAM(enum ssd1306_result_t *result);
+enum ssd1306_request_t ssd1306_setPixelsFromRAMOn(uint8_t display, enum ssd1306_result_t *result);
 enum ssd1306_request_t ssd1306_setAllPixelsActive(enum ssd1306_result_t *result);
+enum ssd1306_request_t ssd1306_setAllPixelsActiveOn(uint8_t display, enum ssd1306_result_t *result);
 
 /*
  * Set normal or inverted display.
  * Default value is normal.
  */
 enum ssd1306_request_t ssd1306_setNormalDisplay(enum ssd1306_result_t *result);
+enum ssd1306_request_t ssd1306_setNormalDisplayOn(uint8_t display, enum ssd1306_result_t *result);
 enum ssd1306_request_t ssd1306_setInvertedDisplay(enum ssd1306_result_t *result);
+enum ssd1306_request_t ssd1306_setInvertedDisplayOn(uint8_t display, enum ssd1306_result_t *result);
 
 /*
  * Turn the OLED panel display on or put it in sleep mode.
  * Default value is sleep mode.
  */
 enum ssd1306_request_t ssd1306_setDisplayOn(enum ssd1306_result_t *result);
+enum ssd1306_request_t ssd1306_setDisplayOnOn(uint8_t display, enum ssd1306_result_t *result);
 enum ssd1306_request_t ssd1306_setDisplaySleep(enum ssd1306_result_t *result);
+enum ssd1306_request_t ssd1306_setDisplaySleepOn(uint8_t display, enum ssd1306_result_t *result);
 
 /*
  * SCROLLING COMMANDS
  */
 
+/*
+ * Direction of the horizontal scroll.
+ */
+enum ssd1306_scroll_direction_t
+{
+    ssd1306_scroll_right,
+    ssd1306_scroll_left
+};
+
+/*
+ * Time interval between each scroll step, in frames.
+ */
+enum ssd1306_scroll_interval_t
+{
+    ssd1306_scroll_5_frames,
+    ssd1306_scroll_64_frames,
+    ssd1306_scroll_128_frames,
+    ssd1306_scroll_256_frames,
+    ssd1306_scroll_3_frames,
+    ssd1306_scroll_4_frames,
+    ssd1306_scroll_25_frames,
+    ssd1306_scroll_2_frames
+};
+
+/*
+ * Set up a continuous horizontal scroll of the pages startPage-endPage (0-7).
+ * The scroll is started with ssd1306_activateScroll.
+ */
+enum ssd1306_request_t ssd1306_setupHorizontalScroll(enum ssd1306_scroll_direction_t direction,
+                                                     uint8_t startPage, uint8_t endPage,
+                                                     enum ssd1306_scroll_interval_t interval,
+                                                     enum ssd1306_result_t *result);
+enum ssd1306_request_t ssd1306_setupHorizontalScrollOn(uint8_t display, enum ssd1306_scroll_direction_t direction,
+                                                       uint8_t startPage, uint8_t endPage,
+                                                       enum ssd1306_scroll_interval_t interval,
+                                                       enum ssd1306_result_t *result);
+
+/*
+ * Set up a continuous vertical and horizontal scroll. The horizontal scroll
+ * applies to the pages startPage-endPage (0-7). The vertical offset (0-63) is
+ * the number of rows that the display scrolls vertically in each step, within
+ * the area set with ssd1306_setVerticalScrollArea. The scroll is started with
+ * ssd1306_activateScroll.
+ */
+enum ssd1306_request_t ssd1306_setupVerticalAndHorizontalScroll(enum ssd1306_scroll_direction_t direction,
+                                                                uint8_t startPage, uint8_t endPage,
+                                                                enum ssd1306_scroll_interval_t interval,
+                                                                uint8_t verticalOffset,
+                                                                enum ssd1306_result_t *result);
+enum ssd1306_request_t ssd1306_setupVerticalAndHorizontalScrollOn(uint8_t display, enum ssd1306_scroll_direction_t direction,
+                                                                  uint8_t startPage, uint8_t endPage,
+                                                                  enum ssd1306_scroll_interval_t interval,
+                                                                  uint8_t verticalOffset,
+                                                                  enum ssd1306_result_t *result);
+
+/*
+ * Set the vertical scroll area: the number of rows in the top fixed area and
+ * the number of rows in the scroll area. The sum must not exceed 64.
+ * Default value is 0 fixed rows and 64 scroll rows.
+ */
+enum ssd1306_request_t ssd1306_setVerticalScrollArea(uint8_t fixedRows, uint8_t scrollRows,
+                                                     enum ssd1306_result_t *result);
+enum ssd1306_request_t ssd1306_setVerticalScrollAreaOn(uint8_t display, uint8_t fixedRows, uint8_t scrollRows,
+                                                       enum ssd1306_result_t *result);
+
+/*
+ * Start or stop the scroll that has been set up. The display RAM must not be
+ * written while the scroll is active. When the scroll is stopped, the data in the
+ * display RAM has been moved and must be sent again.
+ * Default value is stopped.
+ */
+enum ssd1306_request_t ssd1306_activateScroll(enum ssd1306_result_t *result);
+enum ssd1306_request_t ssd1306_activateScrollOn(uint8_t display, enum ssd1306_result_t *result);
+enum ssd1306_request_t ssd1306_deactivateScroll(enum ssd1306_result_t *result);
+enum ssd1306_request_t ssd1306_deactivateScrollOn(uint8_t display, enum ssd1306_result_t *result);
+
+/*
+ * ADVANCED GRAPHIC COMMANDS
+ */
+
+/*
+ * Effect run by the display on its own.
+ */
+enum ssd1306_fade_mode_t
+{
+    ssd1306_fade_off,
+    ssd1306_fade_out,
+    ssd1306_fade_blink
+};
+
+/*
+ * Fade out the display, or let it blink (fade out and in again repeatedly).
+ * The brightness changes one step every 8 * (interval + 1) frames, where
+ * interval is 0-15. The contents of the display RAM are not changed, so the
+ * effect needs no graphics data.
+ * Default value is off.
+ */
+enum ssd1306_request_t ssd1306_setFadeOut(enum ssd1306_fade_mode_t mode, uint8_t interval,
+                                          enum ssd1306_result_t *result);
+enum ssd1306_request_t ssd1306_setFadeOutOn(uint8_t display, enum ssd1306_fade_mode_t mode, uint8_t interval,
+                                            enum ssd1306_result_t *result);
+
+/*
+ * Enable or disable zoom in. When enabled, the upper half of the rows are
+ * shown at double height over the whole panel. The COM pins must use the
+ * alternative configuration (see ssd1306_setComPinsHardwareConfig).
+ * Default value is disabled.
+ */
+enum ssd1306_request_t ssd1306_enableZoomIn(enum ssd1306_result_t *result);
+enum ssd1306_request_t ssd1306_enableZoomInOn(uint8_t display, enum ssd1306_result_t *result);
+enum ssd1306_request_t ssd1306_disableZoomIn(enum ssd1306_result_t *result);
+enum ssd1306_request_t ssd1306_disableZoomInOn(uint8_t display, enum ssd1306_result_t *result);
+
 /*
  * ADDRESSING SETTING COMMANDS
  */
@@ -100,6 +323,11 @@ enum ssd1306_request_t ssd1306_setDisplaySleep(enum ssd1306_result_t *result);
 /*
  * Set the memory addressing mode. The value will be used when data is sent to
  * the display. Page addressing mode is default.
+ *
+ * In page addressing mode, the data is sent one page of the window at a time.
+ * Before each page, a short header with the page start and column start commands
+ * is sent (only the parts that change the RAM pointer). This has less overhead
+ * than the window commands for small updates.
  */
 enum ssd1306_addressing_mode_t
 {
@@ -108,17 +336,24 @@ enum ssd1306_addressing_mode_t
     ssd1306_addressing_page
 };
 void ssd1306_setMemoryAddressingMode(enum ssd1306_addressing_mode_t mode);
+void ssd1306_setMemoryAddressingModeOn(uint8_t display, enum ssd1306_addressing_mode_t mode);
 
 /*
  * Set the column start and end addresses. The values will be used when data is
  * sent to the display. Note that wrapping mechanisms differ depending on which
  * memory addressing mode that is used. Consult the data sheet for details.
  *
- * Column range: 0-127 (default: start=0, end=127)
- * Page range: 0-7 (default: start=0, end=7)
+ * The columns are counted from the first column shown on the panel, the column
+ * offset in the config file is added by the driver. The pages are the pages of
+ * the display RAM, which has 8 pages also if the panel shows fewer.
+ *
+ * Column range: 0-(SSD1306_WIDTH-1) (default: start=0, end=SSD1306_WIDTH-1)
+ * Page range: 0-7 (default: start=0, end=SSD1306_HEIGHT/8-1)
  */
 void ssd1306_setColumnAddress(uint8_t startAddress, uint8_t endAddress);
+void ssd1306_setColumnAddressOn(uint8_t display, uint8_t startAddress, uint8_t endAddress);
 void ssd1306_setPageAddress(uint8_t startAddress, uint8_t endAddress);
+void ssd1306_setPageAddressOn(uint8_t display, uint8_t startAddress, uint8_t endAddress);
 
 /*
  * HARDWARE CONFIGURATION COMMANDS
@@ -129,19 +364,23 @@ void ssd1306_setPageAddress(uint8_t startAddress, uint8_t endAddress);
  * Default value is 0.
  */
 enum ssd1306_request_t ssd1306_setDisplayStartLine(uint8_t line, enum ssd1306_result_t *result);
+enum ssd1306_request_t ssd1306_setDisplayStartLineOn(uint8_t display, uint8_t line, enum ssd1306_result_t *result);
 
 /*
  * Set which column address that is mapped to segment 0.
  * Default value is 0.
  */
 enum ssd1306_request_t ssd1306_setSegmentRemap_0(enum ssd1306_result_t *result);
+enum ssd1306_request_t ssd1306_setSegmentRemap_0On(uint8_t display, enum ssd1306_result_t *result);
 enum ssd1306_request_t ssd1306_setSegmentRemap_127(enum ssd1306_result_t *result);
+enum ssd1306_request_t ssd1306_setSegmentRemap_127On(uint8_t display, enum ssd1306_result_t *result);
 
 /*
  * Set MUX ratio from 16MUX to 64MUX (decimal).
  * Default value is 64.
  */
 enum ssd1306_request_t ssd1306_setMultiplexRatio(uint8_t ratio, enum ssd1306_result_t *result);
+enum ssd1306_request_t ssd1306_setMultiplexRatioOn(uint8_t display, uint8_t ratio, enum ssd1306_result_t *result);
 
 /*
  * This commandType sets the scan direction of the COM output.
@@ -149,13 +388,40 @@ enum ssd1306_request_t ssd1306_setMultiplexRatio(uint8_t ratio, enum ssd1306_res
  * Default value is normal.
  */
 enum ssd1306_request_t ssd1306_setComOutputScanDirectionNormal(enum ssd1306_result_t *result);
+enum ssd1306_request_t ssd1306_setComOutputScanDirectionNormalOn(uint8_t display, enum ssd1306_result_t *result);
 enum ssd1306_request_t ssd1306_setComOutputScanDirectionRemapped(enum ssd1306_result_t *result);
+enum ssd1306_request_t ssd1306_setComOutputScanDirectionRemappedOn(uint8_t display, enum ssd1306_result_t *result);
+
+/*
+ * Orientation of the image on the panel.
+ */
+enum ssd1306_orientation_t
+{
+    ssd1306_orientation_normal,
+    ssd1306_orientation_rotated_180,
+    ssd1306_orientation_mirrored_horizontal,
+    ssd1306_orientation_mirrored_vertical
+};
+
+/*
+ * Set the orientation by changing the segment remap and the COM scan direction
+ * in one command. The COM scan direction (vertical mirror) applies to the image
+ * directly, but the segment remap (horizontal mirror) only applies to data that
+ * is sent after the command. The graphics data must therefore be sent again when
+ * the horizontal direction changes.
+ * Default value is normal (set by ssd1306_initDisplay).
+ */
+enum ssd1306_request_t ssd1306_setOrientation(enum ssd1306_orientation_t orientation,
+                                              enum ssd1306_result_t *result);
+enum ssd1306_request_t ssd1306_setOrientationOn(uint8_t display, enum ssd1306_orientation_t orientation,
+                                                enum ssd1306_result_t *result);
 
 /*
  * Set vertical shift from 0-63 (decimal).
  * Default value is 0.
  */
 enum ssd1306_request_t ssd1306_setDisplayOffset(uint8_t offset, enum ssd1306_result_t *result);
+enum ssd1306_request_t ssd1306_setDisplayOffsetOn(uint8_t display, uint8_t offset, enum ssd1306_result_t *result);
 
 /*
  * Specify COM pins hardware configuration.
@@ -171,6 +437,7 @@ enum ssd1306_request_t ssd1306_setDisplayOffset(uint8_t offset, enum ssd1306_res
  *   Default value is false.
  */
 enum ssd1306_request_t ssd1306_setComPinsHardwareConfig(bool useAltComPinConf, bool enableLeftRightRemap, enum ssd1306_result_t *result);
+enum ssd1306_request_t ssd1306_setComPinsHardwareConfigOn(uint8_t display, bool useAltComPinConf, bool enableLeftRightRemap, enum ssd1306_result_t *result);
 
 
 /*
@@ -190,6 +457,7 @@ enum ssd1306_request_t ssd1306_setComPinsHardwareConfig(bool useAltComPinConf, b
  *   Default value is 8.
  */
 enum ssd1306_request_t ssd1306_setDisplayClock(uint8_t divideRatio, uint8_t oscillatorFrequency, enum ssd1306_result_t *result);
+enum ssd1306_request_t ssd1306_setDisplayClockOn(uint8_t display, uint8_t divideRatio, uint8_t oscillatorFrequency, enum ssd1306_result_t *result);
 
 /*
  * CHARGE PUMP REGULATOR COMMANDS
@@ -202,7 +470,9 @@ enum ssd1306_request_t ssd1306_setDisplayClock(uint8_t divideRatio, uint8_t osci
  * The charge pump is disabled by default.
  */
 enum ssd1306_request_t ssd1306_enableChargePump(enum ssd1306_result_t *result);
+enum ssd1306_request_t ssd1306_enableChargePumpOn(uint8_t display, enum ssd1306_result_t *result);
 enum ssd1306_request_t ssd1306_disableChargePump(enum ssd1306_result_t *result);
+enum ssd1306_request_t ssd1306_disableChargePumpOn(uint8_t display, enum ssd1306_result_t *result);
 
 
 /**** DATA SEND COMMAND ****/
@@ -216,5 +486,39 @@ enum ssd1306_request_t ssd1306_disableChargePump(enum ssd1306_result_t *result);
  * page and start/end column.
  */
 enum ssd1306_request_t ssd1306_sendGraphicsData(uint8_t *buffer, uint16_t len, enum ssd1306_result_t *result);
+enum ssd1306_request_t ssd1306_sendGraphicsDataOn(uint8_t display, uint8_t *buffer, uint16_t len, enum ssd1306_result_t *result);
+
+/*
+ * Part of the graphics data to send. The data is sent directly from the memory
+ * that "data" points to, e.g., a line segment in the framebuffer.
+ */
+struct ssd1306_data_span_t
+{
+    const uint8_t *data;
+    uint16_t len;
+};
+
+/*
+ * The function will send the graphics data in a list of spans, in the same way as
+ * ssd1306_sendGraphicsData. The spans are sent in order, one transfer per span, and
+ * are written to the display as if they were one contiguous buffer. This makes it
+ * possible to send a part of the framebuffer that is not contiguous in memory (for
+ * example a rectangle that does not cover whole lines) without copying it first.
+ * Neither the list nor the data must be modified until the result output parameter
+ * is set to ssd1306_result_ok.
+ */
+enum ssd1306_request_t ssd1306_sendGraphicsSpans(const struct ssd1306_data_span_t *spans, uint8_t count,
+                                                 enum ssd1306_result_t *result);
+enum ssd1306_request_t ssd1306_sendGraphicsSpansOn(uint8_t display, const struct ssd1306_data_span_t *spans, uint8_t count,
+                                                   enum ssd1306_result_t *result);
+
+/*
+ * Get the number of bytes at the start of the graphics data of the last data
+ * request that the display has received. The data of a transfer that is in
+ * progress is not counted. The data that has been received may be modified
+ * while the rest is sent.
+ */
+uint16_t ssd1306_getDataProgress(void);
+uint16_t ssd1306_getDataProgressOn(uint8_t display);
 
 #endif // SSD1306_H
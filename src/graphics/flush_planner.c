@@ -0,0 +1,342 @@
+/*
+ * Flush planner for the graphics library.
+ *
+ * Copyright (c) 2021. BlueZephyr
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ *
+ */
+
+#include <stdbool.h>
+#include "flush_planner.h"
+
+/*
+ * Panel n shows the columns from n*PANEL_WIDTH (see graphics.c)
+ */
+#define PANEL_WIDTH (FRAMEBUFFER_X_PIXELS / GRAPHICS_PANELS)
+
+/*
+ * Internal variables for the planner
+ */
+static struct flush_planner_t
+{
+    bool lastAreaValid;
+    struct framebuffer_area_t lastArea;     // Last area of the previous plan
+} self;
+
+/*
+ * Local function prototypes
+ */
+static uint8_t getPageSpanAreas(struct framebuffer_area_t *areas);
+static uint8_t mergeWhileCheaper(struct framebuffer_area_t *areas, uint8_t count);
+static uint8_t mergePair(struct framebuffer_area_t *areas, uint8_t count, uint8_t first, uint8_t second);
+static bool clipArea(struct framebuffer_area_t *area, const struct framebuffer_area_t *other);
+static bool areasOverlap(const struct framebuffer_area_t *a, const struct framebuffer_area_t *b);
+static uint16_t totalCost(const struct framebuffer_area_t *areas, uint8_t count);
+static struct framebuffer_area_t mergeAreas(const struct framebuffer_area_t *a, const struct framebuffer_area_t *b);
+static uint16_t areaCost(const struct framebuffer_area_t *area, bool windowKnown);
+static bool sameArea(const struct framebuffer_area_t *a, const struct framebuffer_area_t *b);
+
+void flush_planner_init(void)
+{
+    self.lastAreaValid = false;
+}
+
+enum flush_plan_t flush_planner_plan(struct framebuffer_area_t *areas, uint8_t *areaCount)
+{
+    struct framebuffer_area_t candidate[FLUSH_PLANNER_MAX_AREAS];
+    enum flush_plan_t best = flush_plan_full_frame;
+    uint16_t bestCost = 0xFFFF;
+
+    for (uint8_t plan=0; plan<FLUSH_PLANS; plan++)
+    {
+        uint8_t count = flush_planner_getAreas((enum flush_plan_t)plan, candidate);
+        uint16_t cost = flush_planner_getCost(candidate, count);
+
+        // Of two plans with the same cost, the first one is used
+        if (cost < bestCost)
+        {
+            best = (enum flush_plan_t)plan;
+            bestCost = cost;
+            for (uint8_t i=0; i<count; i++)
+            {
+                areas[i] = candidate[i];
+            }
+            *areaCount = count;
+        }
+    }
+
+    if (*areaCount > 0)
+    {
+        self.lastArea = areas[*areaCount - 1];
+        self.lastAreaValid = true;
+    }
+    return best;
+}
+
+uint8_t flush_planner_getAreas(enum flush_plan_t plan, struct framebuffer_area_t *areas)
+{
+    switch (plan)
+    {
+        case flush_plan_dirty_areas:
+            return mergeWhileCheaper(areas, framebuffer_getDirtyAreas(areas));
+        case flush_plan_page_spans:
+            return mergeWhileCheaper(areas, getPageSpanAreas(areas));
+        case flush_plan_bounding_box:
+            framebuffer_getDirtyArea(&areas[0].xStart, &areas[0].xEnd, &areas[0].yStart, &areas[0].yEnd);
+            return 1;
+        case flush_plan_full_frame:
+        default:
+            areas[0].xStart = 0;
+            areas[0].xEnd = FRAMEBUFFER_X_PIXELS - 1;
+            areas[0].yStart = 0;
+            areas[0].yEnd = FLUSH_PLANNER_PAGES - 1;
+            return 1;
+    }
+}
+
+uint16_t flush_planner_getCost(const struct framebuffer_area_t *areas, uint8_t count)
+{
+    uint16_t cost = 0;
+
+    for (uint8_t i=0; i<count; i++)
+    {
+        bool windowKnown = (i == 0) && self.lastAreaValid && !GRAPHICS_PAGE_FLIP &&
+                           sameArea(&areas[0], &self.lastArea);
+
+        cost += areaCost(&areas[i], windowKnown);
+    }
+    return cost;
+}
+
+/*
+ * Make an area of the modified columns of each page. Pages next to each other
+ * with the same columns are put in the same area. Returns the number of areas.
+ */
+static uint8_t getPageSpanAreas(struct framebuffer_area_t *areas)
+{
+    uint8_t count = 0;
+    uint8_t xStart;
+    uint8_t xEnd;
+
+    for (uint8_t page=0; page<FLUSH_PLANNER_PAGES; page++)
+    {
+        if (!framebuffer_getDirtySpan(page, &xStart, &xEnd))
+        {
+            continue;
+        }
+        if ((count > 0) && (areas[count - 1].yEnd == page - 1) &&
+            (areas[count - 1].xStart == xStart) && (areas[count - 1].xEnd == xEnd))
+        {
+            areas[count - 1].yEnd = page;
+        }
+        else
+        {
+            areas[count].xStart = xStart;
+            areas[count].xEnd = xEnd;
+            areas[count].yStart = page;
+            areas[count].yEnd = page;
+            count++;
+        }
+    }
+    return count;
+}
+
+/*
+ * Merge the two areas that save the most when merged, until no merge saves
+ * anything. The saving of a merge is counted on all the areas, since the merged
+ * area may cover parts of other areas (see mergePair). Returns the number of
+ * areas.
+ */
+static uint8_t mergeWhileCheaper(struct framebuffer_area_t *areas, uint8_t count)
+{
+    struct framebuffer_area_t candidate[FLUSH_PLANNER_MAX_AREAS];
+    struct framebuffer_area_t best[FLUSH_PLANNER_MAX_AREAS];
+
+    for (;;)
+    {
+        uint16_t bestCost = totalCost(areas, count);
+        uint8_t bestCount = 0;
+
+        for (uint8_t i=0; i<count; i++)
+        {
+            for (uint8_t j=i+1; j<count; j++)
+            {
+                uint8_t candidateCount;
+                uint16_t cost;
+
+                for (uint8_t k=0; k<count; k++)
+                {
+                    candidate[k] = areas[k];
+                }
+                candidateCount = mergePair(candidate, count, i, j);
+                cost = totalCost(candidate, candidateCount);
+                if (cost < bestCost)
+                {
+                    for (uint8_t k=0; k<candidateCount; k++)
+                    {
+                        best[k] = candidate[k];
+                    }
+                    bestCount = candidateCount;
+                    bestCost = cost;
+                }
+            }
+        }
+        if (bestCount == 0)
+        {
+            return count;
+        }
+        for (uint8_t k=0; k<bestCount; k++)
+        {
+            areas[k] = best[k];
+        }
+        count = bestCount;
+    }
+}
+
+/*
+ * Merge the areas at index first and second (first < second). The other areas
+ * must not overlap the merged area, so that no part is sent twice: an area that
+ * is covered by it is removed, and an area that sticks out on one side is
+ * clipped to the part outside it. Other areas are merged into it as well.
+ * Returns the number of areas.
+ */
+static uint8_t mergePair(struct framebuffer_area_t *areas, uint8_t count, uint8_t first, uint8_t second)
+{
+    struct framebuffer_area_t merged = mergeAreas(&areas[first], &areas[second]);
+    uint8_t i = 0;
+
+    count--;
+    areas[second] = areas[count];
+    count--;
+    areas[first] = areas[count];
+
+    while (i < count)
+    {
+        struct framebuffer_area_t *other = &areas[i];
+
+        if (!areasOverlap(other, &merged) || clipArea(other, &merged))
+        {
+            i++;
+            continue;
+        }
+
+        // Covered by the merged area, or merged into it. The grown area may
+        // overlap areas that have already been checked, so start over.
+        merged = mergeAreas(&merged, other);
+        count--;
+        areas[i] = areas[count];
+        i = 0;
+    }
+    areas[count++] = merged;
+    return count;
+}
+
+/*
+ * Clip the area to the part that is outside the other area, if that part is an
+ * area (a side of the area). Returns false if the area is covered by the other
+ * area or sticks out on more than one side.
+ */
+static bool clipArea(struct framebuffer_area_t *area, const struct framebuffer_area_t *other)
+{
+    bool insideX = (area->xStart >= other->xStart) && (area->xEnd <= other->xEnd);
+    bool insideY = (area->yStart >= other->yStart) && (area->yEnd <= other->yEnd);
+
+    if (insideX == insideY)
+    {
+        return false;
+    }
+    if (insideY)
+    {
+        if (area->xStart >= other->xStart)
+        {
+            area->xStart = other->xEnd + 1;
+        }
+        else if (area->xEnd <= other->xEnd)
+        {
+            area->xEnd = other->xStart - 1;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    else
+    {
+        if (area->yStart >= other->yStart)
+        {
+            area->yStart = other->yEnd + 1;
+        }
+        else if (area->yEnd <= other->yEnd)
+        {
+            area->yEnd = other->yStart - 1;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool areasOverlap(const struct framebuffer_area_t *a, const struct framebuffer_area_t *b)
+{
+    return (a->xStart <= b->xEnd) && (b->xStart <= a->xEnd) &&
+           (a->yStart <= b->yEnd) && (b->yStart <= a->yEnd);
+}
+
+static uint16_t totalCost(const struct framebuffer_area_t *areas, uint8_t count)
+{
+    uint16_t cost = 0;
+
+    for (uint8_t i=0; i<count; i++)
+    {
+        cost += areaCost(&areas[i], false);
+    }
+    return cost;
+}
+
+static struct framebuffer_area_t mergeAreas(const struct framebuffer_area_t *a, const struct framebuffer_area_t *b)
+{
+    struct framebuffer_area_t merged;
+
+    merged.xStart = (a->xStart < b->xStart) ? a->xStart : b->xStart;
+    merged.xEnd = (a->xEnd > b->xEnd) ? a->xEnd : b->xEnd;
+    merged.yStart = (a->yStart < b->yStart) ? a->yStart : b->yStart;
+    merged.yEnd = (a->yEnd > b->yEnd) ? a->yEnd : b->yEnd;
+    return merged;
+}
+
+/*
+ * Cost of an area. The part on each panel is sent on its own, with a window
+ * change and one transaction for each chunk of data.
+ */
+static uint16_t areaCost(const struct framebuffer_area_t *area, bool windowKnown)
+{
+    uint16_t cost = 0;
+    uint8_t pages = area->yEnd - area->yStart + 1;
+
+    for (uint8_t panel = area->xStart / PANEL_WIDTH; panel <= area->xEnd / PANEL_WIDTH; panel++)
+    {
+        uint8_t panelStart = panel * PANEL_WIDTH;
+        uint8_t panelEnd = panelStart + PANEL_WIDTH - 1;
+        uint8_t xStart = (area->xStart > panelStart) ? area->xStart : panelStart;
+        uint8_t xEnd = (area->xEnd < panelEnd) ? area->xEnd : panelEnd;
+        uint16_t bytes = (uint16_t)(xEnd - xStart + 1) * pages;
+        uint16_t chunks = (bytes + SSD1306_DATA_CHUNK_SIZE - 1) / SSD1306_DATA_CHUNK_SIZE;
+
+        cost += bytes + chunks * FLUSH_COST_TRANSFER;
+        if (!windowKnown)
+        {
+            cost += FLUSH_COST_WINDOW;
+        }
+    }
+    return cost;
+}
+
+static bool sameArea(const struct framebuffer_area_t *a, const struct framebuffer_area_t *b)
+{
+    return (a->xStart == b->xStart) && (a->xEnd == b->xEnd) &&
+           (a->yStart == b->yStart) && (a->yEnd == b->yEnd);
+}
@@ -18,22 +18,60 @@
 #define FRAMEBUFFER_MAX_X (FRAMEBUFFER_X_PIXELS - 1)
 #define FRAMEBUFFER_MAX_Y (FRAMEBUFFER_Y_PIXELS - 1)
 #define FRAMEBUFFER_MAX_Y_SEG (FRAMEBUFFER_MAX_Y / 8)
+#define FRAMEBUFFER_LINES (FRAMEBUFFER_MAX_Y_SEG + 1)
+#define SPAN_CLEAN_START 0xFF
+#define SPAN_CLEAN_END 0
+#define ALL_LINES ((uint32_t)(0xFFFFFFFFu >> (32u - FRAMEBUFFER_LINES)))
+
+/*
+ * The data that is sent to the display
+ */
+#if (FRAMEBUFFER_DOUBLE_BUFFER)
+#define SEND_SEGMENTS self.frontSegments
+#else
+#define SEND_SEGMENTS self.dataSegments
+#endif
 #define FRAMEBUFFER_MIN_X 0
 #define FRAMEBUFFER_MIN_Y 0
 
+/*
+ * Check of an x position (uint8_t). All positions are inside a framebuffer that
+ * is 256 pixels wide.
+ */
+#if (FRAMEBUFFER_X_PIXELS > 255u)
+#define INSIDE_X(x) true
+#else
+#define INSIDE_X(x) ((x) < FRAMEBUFFER_X_PIXELS)
+#endif
+
+#if (FRAMEBUFFER_SIZE < FRAMEBUFFER_X_PIXELS * (FRAMEBUFFER_MAX_Y_SEG + 1))
+#error "FRAMEBUFFER_SIZE is too small for FRAMEBUFFER_X_PIXELS * FRAMEBUFFER_Y_PIXELS"
+#endif
+
+#if (FRAMEBUFFER_DIRTY_AREAS < 1u)
+#error "FRAMEBUFFER_DIRTY_AREAS must be at least 1"
+#endif
+
 /*
  * Internal variables for the framebuffer.
  */
 static struct framebuffer_t
 {
     uint8_t dataSegments[FRAMEBUFFER_SIZE];
+#if (FRAMEBUFFER_DOUBLE_BUFFER)
+    uint8_t frontSegments[FRAMEBUFFER_SIZE];
+#endif
     uint8_t dirtySegX1;   // Top left segment in the dirty table
     uint8_t dirtySegY1;   // Top left segment in the dirty table
     uint8_t dirtySegX2;   // Bottom right dirty segment
     uint8_t dirtySegY2;   // Bottom right dirty segment
+    struct framebuffer_area_t dirtyAreas[FRAMEBUFFER_DIRTY_AREAS];  // Disjoint parts of the dirty area
+    uint8_t dirtyAreaCount;
+    uint8_t dirtySpanStart[FRAMEBUFFER_LINES];  // Modified columns on each line. The line is
+    uint8_t dirtySpanEnd[FRAMEBUFFER_LINES];    // clean if the start is after the end.
     uint16_t dataPos;    // Next byte to be copied to the display
     uint8_t error;
-    bool isLocked;
+    uint32_t lockedLines;   // Lines that are being sent (bit n is line n)
     bool isDirty;
 } self;
 
@@ -41,6 +79,14 @@ static struct framebuffer_t
  * Local function prototypes
  */
 static void updateDirtyArea(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2);
+static void addDirtyArea(struct framebuffer_area_t area);
+static void setDirtySpans(uint8_t start, uint8_t end);
+static void mergeTouchingAreas(struct framebuffer_area_t *area);
+static uint8_t cheapestAreaToMerge(const struct framebuffer_area_t *area);
+static void removeDirtyArea(uint8_t index, struct framebuffer_area_t *area);
+static bool areasTouch(const struct framebuffer_area_t *a, const struct framebuffer_area_t *b);
+static uint16_t areaSize(const struct framebuffer_area_t *area);
+static bool linesLocked(uint8_t firstLine, uint8_t lastLine);
 
 /*
  * Init function for the framebuffer. The main data element is the
@@ -53,15 +99,24 @@ void framebuffer_init (void)
     self.dirtySegY1 = 0;
     self.dirtySegX2 = FRAMEBUFFER_MAX_X;
     self.dirtySegY2 = FRAMEBUFFER_MAX_Y_SEG;
+    self.dirtyAreas[0].xStart = self.dirtySegX1;
+    self.dirtyAreas[0].xEnd = self.dirtySegX2;
+    self.dirtyAreas[0].yStart = self.dirtySegY1;
+    self.dirtyAreas[0].yEnd = self.dirtySegY2;
+    self.dirtyAreaCount = 1;
+    setDirtySpans(0, FRAMEBUFFER_MAX_X);
     self.dataPos = POS_UNDEFINED;
     self.error = 0;
     self.isDirty = true;
-    self.isLocked = false;
+    self.lockedLines = 0;
 
     // Clear the framebuffer
     for (uint16_t i=0; i<FRAMEBUFFER_SIZE; i++)
     {
         self.dataSegments[i] = 0;
+#if (FRAMEBUFFER_DOUBLE_BUFFER)
+        self.frontSegments[i] = 0;
+#endif
     }
 }
 
@@ -88,7 +143,7 @@ uint8_t* framebuffer_getDirtyAreaBuffer (uint8_t *yStartSeg, uint16_t *bufferLen
     *yStartSeg = firstDirtyLine;
 
     // Set the buffer pointer to the first segment of the line that contains
-    dirtyBuffer = self.dataSegments + firstDirtySegmentPos;
+    dirtyBuffer = SEND_SEGMENTS + firstDirtySegmentPos;
 
     // Clear dirty area
     self.isDirty = false;
@@ -98,7 +153,12 @@ uint8_t* framebuffer_getDirtyAreaBuffer (uint8_t *yStartSeg, uint16_t *bufferLen
 
 bool framebuffer_isLocked (void)
 {
-    return self.isLocked;
+    return self.lockedLines != 0;
+}
+
+bool framebuffer_isLineLocked (uint8_t ySeg)
+{
+    return linesLocked(ySeg, ySeg);
 }
 
 bool framebuffer_isDirty(void)
@@ -106,6 +166,11 @@ bool framebuffer_isDirty(void)
     return self.isDirty;
 }
 
+void framebuffer_clearDirty(void)
+{
+    self.isDirty = false;
+}
+
 void framebuffer_getDirtyArea (uint8_t* xStartSeg, uint8_t* xEndSeg,
                                uint8_t* yStartSeg, uint8_t* yEndSeg)
 {
@@ -115,6 +180,26 @@ void framebuffer_getDirtyArea (uint8_t* xStartSeg, uint8_t* xEndSeg,
     *yEndSeg = self.dirtySegY2;
 }
 
+uint8_t framebuffer_getDirtyAreas (struct framebuffer_area_t *areas)
+{
+    for (uint8_t i=0; i<self.dirtyAreaCount; i++)
+    {
+        areas[i] = self.dirtyAreas[i];
+    }
+    return self.dirtyAreaCount;
+}
+
+bool framebuffer_getDirtySpan (uint8_t ySeg, uint8_t *xStartSeg, uint8_t *xEndSeg)
+{
+    if ((ySeg > FRAMEBUFFER_MAX_Y_SEG) || (self.dirtySpanStart[ySeg] > self.dirtySpanEnd[ySeg]))
+    {
+        return false;
+    }
+    *xStartSeg = self.dirtySpanStart[ySeg];
+    *xEndSeg = self.dirtySpanEnd[ySeg];
+    return true;
+}
+
 uint16_t framebuffer_copyDirtyArea (uint8_t* buffer, uint16_t bufferLen)
 {
     uint8_t x_len = self.dirtySegX2 - self.dirtySegX1 + 1;
@@ -136,7 +221,7 @@ uint16_t framebuffer_copyDirtyArea (uint8_t* buffer, uint16_t bufferLen)
             {
                 self.error = 1;
             }
-            buffer[i] = self.dataSegments[self.dataPos];
+            buffer[i] = SEND_SEGMENTS[self.dataPos];
             copied++;
 
             // Get the next segment to copy
@@ -152,7 +237,7 @@ uint16_t framebuffer_copyDirtyArea (uint8_t* buffer, uint16_t bufferLen)
             {
                 // Done
                 self.isDirty = 0;
-                self.isLocked = 0;
+                self.lockedLines = 0;
                 self.dataPos = POS_UNDEFINED;
                 break;
             }
@@ -163,13 +248,36 @@ uint16_t framebuffer_copyDirtyArea (uint8_t* buffer, uint16_t bufferLen)
     return copied;
 }
 
+const uint8_t* framebuffer_getSegments (uint8_t xSeg, uint8_t ySeg)
+{
+    return SEND_SEGMENTS + ySeg * FRAMEBUFFER_X_PIXELS + xSeg;
+}
+
+#if (FRAMEBUFFER_DOUBLE_BUFFER)
+void framebuffer_copyToFront (void)
+{
+    if (!self.isDirty)
+    {
+        return;
+    }
+    for (uint8_t line=0; line<FRAMEBUFFER_LINES; line++)
+    {
+        for (uint16_t x=self.dirtySpanStart[line]; x<=self.dirtySpanEnd[line]; x++)
+        {
+            uint16_t pos = line * FRAMEBUFFER_X_PIXELS + x;
+            self.frontSegments[pos] = self.dataSegments[pos];
+        }
+    }
+}
+#endif
+
 void framebuffer_show(void)
 {
     // Only applicable if there is something to update
     if (self.isDirty)
     {
         // Lock the framebuffer for writing
-        self.isLocked = 1;
+        self.lockedLines = ALL_LINES;
     }
 }
 
@@ -178,7 +286,7 @@ void framebuffer_show(void)
  */
 static void updateDirtyArea(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2)
 {
-    if((x2 > FRAMEBUFFER_MAX_X) || (y2 > FRAMEBUFFER_MAX_Y_SEG))
+    if(!INSIDE_X(x2) || (y2 > FRAMEBUFFER_MAX_Y_SEG))
     {
         // Outside the framebuffer
         self.error = 1;
@@ -190,6 +298,8 @@ static void updateDirtyArea(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2)
         self.dirtySegY1 = y1;
         self.dirtySegX2 = x2;
         self.dirtySegY2 = y2;
+        self.dirtyAreaCount = 0;
+        setDirtySpans(SPAN_CLEAN_START, SPAN_CLEAN_END);
     }
     if(self.dirtySegX1 > x1)
         self.dirtySegX1 = x1;
@@ -200,20 +310,166 @@ static void updateDirtyArea(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2)
     if(self.dirtySegY2 < y2)
         self.dirtySegY2 = y2;
 
+    struct framebuffer_area_t area = {x1, x2, y1, y2};
+    addDirtyArea(area);
+
+    for (uint8_t line=y1; line<=y2; line++)
+    {
+        if (self.dirtySpanStart[line] > x1)
+            self.dirtySpanStart[line] = x1;
+        if (self.dirtySpanEnd[line] < x2)
+            self.dirtySpanEnd[line] = x2;
+    }
+
     // Set the fb dirty flag
     self.isDirty = 1;
 }
 
+/*
+ * Set the modified columns of all lines.
+ */
+static void setDirtySpans(uint8_t start, uint8_t end)
+{
+    for (uint8_t line=0; line<FRAMEBUFFER_LINES; line++)
+    {
+        self.dirtySpanStart[line] = start;
+        self.dirtySpanEnd[line] = end;
+    }
+}
+
+/*
+ * Add an area to the list of dirty areas. The area is merged with the areas
+ * that it overlaps or touches. If the list is full, the area is merged with the
+ * area that gives the smallest increase in size until there is room.
+ */
+static void addDirtyArea(struct framebuffer_area_t area)
+{
+    mergeTouchingAreas(&area);
+    while (self.dirtyAreaCount >= FRAMEBUFFER_DIRTY_AREAS)
+    {
+        removeDirtyArea(cheapestAreaToMerge(&area), &area);
+        mergeTouchingAreas(&area);
+    }
+    self.dirtyAreas[self.dirtyAreaCount++] = area;
+}
+
+/*
+ * Merge the dirty areas that overlap or touch the area into it. The grown area
+ * may touch areas that have already been checked, so the check starts over after
+ * each merge.
+ */
+static void mergeTouchingAreas(struct framebuffer_area_t *area)
+{
+    uint8_t i = 0;
+
+    while (i < self.dirtyAreaCount)
+    {
+        if (areasTouch(&self.dirtyAreas[i], area))
+        {
+            removeDirtyArea(i, area);
+            i = 0;
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
+/*
+ * Find the dirty area that adds the fewest segments when it is merged with the
+ * area.
+ */
+static uint8_t cheapestAreaToMerge(const struct framebuffer_area_t *area)
+{
+    uint8_t cheapest = 0;
+    uint16_t cheapestCost = 0xFFFF;
+
+    for (uint8_t i=0; i<self.dirtyAreaCount; i++)
+    {
+        const struct framebuffer_area_t *other = &self.dirtyAreas[i];
+        struct framebuffer_area_t merged;
+        uint16_t cost;
+
+        merged.xStart = (other->xStart < area->xStart) ? other->xStart : area->xStart;
+        merged.xEnd = (other->xEnd > area->xEnd) ? other->xEnd : area->xEnd;
+        merged.yStart = (other->yStart < area->yStart) ? other->yStart : area->yStart;
+        merged.yEnd = (other->yEnd > area->yEnd) ? other->yEnd : area->yEnd;
+        cost = areaSize(&merged) - areaSize(other) - areaSize(area);
+        if (cost < cheapestCost)
+        {
+            cheapest = i;
+            cheapestCost = cost;
+        }
+    }
+    return cheapest;
+}
+
+/*
+ * Remove the dirty area at index from the list and merge it into area.
+ */
+static void removeDirtyArea(uint8_t index, struct framebuffer_area_t *area)
+{
+    const struct framebuffer_area_t *other = &self.dirtyAreas[index];
+
+    if (area->xStart > other->xStart)
+        area->xStart = other->xStart;
+    if (area->xEnd < other->xEnd)
+        area->xEnd = other->xEnd;
+    if (area->yStart > other->yStart)
+        area->yStart = other->yStart;
+    if (area->yEnd < other->yEnd)
+        area->yEnd = other->yEnd;
+
+    self.dirtyAreaCount--;
+    self.dirtyAreas[index] = self.dirtyAreas[self.dirtyAreaCount];
+}
+
+/*
+ * Returns true if the areas overlap or are next to each other (also diagonally).
+ */
+static bool areasTouch(const struct framebuffer_area_t *a, const struct framebuffer_area_t *b)
+{
+    return (a->xStart <= b->xEnd + 1) && (b->xStart <= a->xEnd + 1) &&
+           (a->yStart <= b->yEnd + 1) && (b->yStart <= a->yEnd + 1);
+}
+
+static uint16_t areaSize(const struct framebuffer_area_t *area)
+{
+    return (uint16_t)(area->xEnd - area->xStart + 1) * (uint16_t)(area->yEnd - area->yStart + 1);
+}
+
+/*
+ * Returns true if any of the lines from firstLine to lastLine is locked.
+ */
+static bool linesLocked(uint8_t firstLine, uint8_t lastLine)
+{
+    for (uint8_t line=firstLine; line<=lastLine && line<FRAMEBUFFER_LINES; line++)
+    {
+        if (self.lockedLines & ((uint32_t)1u << line))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
 /*
  * Pixel functions
  */
-void framebuffer_setPixel(uint8_t xPos, uint8_t yPos)
+bool framebuffer_setPixel(uint8_t xPos, uint8_t yPos)
 {
-    if (xPos<FRAMEBUFFER_X_PIXELS && yPos<FRAMEBUFFER_Y_PIXELS)
+    if (INSIDE_X(xPos) && yPos<FRAMEBUFFER_Y_PIXELS)
     {
         uint16_t dataPos;
         uint8_t segment_y = yPos / 8;
 
+        if (linesLocked(segment_y, segment_y))
+        {
+            // The line is being sent to the display
+            return false;
+        }
+
         // Find the correct segment row
         dataPos = segment_y * FRAMEBUFFER_X_PIXELS;
 
@@ -225,15 +481,22 @@ void framebuffer_setPixel(uint8_t xPos, uint8_t yPos)
 
         updateDirtyArea(xPos, segment_y, xPos, segment_y);
     }
+    return true;
 }
 
-void framebuffer_clearPixel(uint8_t xPos, uint8_t yPos)
+bool framebuffer_clearPixel(uint8_t xPos, uint8_t yPos)
 {
-    if (xPos<FRAMEBUFFER_X_PIXELS && yPos<FRAMEBUFFER_Y_PIXELS)
+    if (INSIDE_X(xPos) && yPos<FRAMEBUFFER_Y_PIXELS)
     {
         uint16_t data_pos = 0;
         uint8_t segment_y = yPos / 8;
 
+        if (linesLocked(segment_y, segment_y))
+        {
+            // The line is being sent to the display
+            return false;
+        }
+
         // Find the correct segment row
         data_pos = segment_y * FRAMEBUFFER_X_PIXELS;
 
@@ -245,11 +508,12 @@ void framebuffer_clearPixel(uint8_t xPos, uint8_t yPos)
 
         updateDirtyArea(xPos, segment_y, xPos, segment_y);
     }
+    return true;
 }
 
 uint8_t framebuffer_getPixel(uint8_t xPos, uint8_t yPos)
 {
-    if (xPos<FRAMEBUFFER_X_PIXELS && yPos<FRAMEBUFFER_Y_PIXELS)
+    if (INSIDE_X(xPos) && yPos<FRAMEBUFFER_Y_PIXELS)
     {
         uint16_t data_pos;
         uint8_t segment_y = yPos / 8;
@@ -263,9 +527,10 @@ uint8_t framebuffer_getPixel(uint8_t xPos, uint8_t yPos)
         // Return the value of the specified pixel
         return self.dataSegments[data_pos] & (1 << (yPos % 8));
     }
+    return 0;
 }
 
-void framebuffer_blit (int8_t x, int8_t y, uint8_t width, uint8_t height, const uint8_t* data)
+bool framebuffer_blit (int16_t x, int8_t y, uint8_t width, uint8_t height, const uint8_t* data)
 {
     uint8_t i, j;
     uint8_t obj_start_x;
@@ -282,11 +547,11 @@ void framebuffer_blit (int8_t x, int8_t y, uint8_t width, uint8_t height, const
 
     // Check if part of the object is outside the framebuffer
     // If so - truncate
-    if ((x + width < FRAMEBUFFER_MIN_X) || (x > FRAMEBUFFER_MAX_X) ||
-        (y + height < FRAMEBUFFER_MIN_Y) || (y > FRAMEBUFFER_MAX_Y))
+    if ((x + width < FRAMEBUFFER_MIN_X) || (x > (int16_t)FRAMEBUFFER_MAX_X) ||
+        (y + height < FRAMEBUFFER_MIN_Y) || (y > (int16_t)FRAMEBUFFER_MAX_Y))
     {
         // Completely outside
-        return;
+        return true;
     }
 
     // Calculate the parts of the blit object on the x-axis that are visible.
@@ -302,7 +567,7 @@ void framebuffer_blit (int8_t x, int8_t y, uint8_t width, uint8_t height, const
         fb_start_x = x;
     }
 
-    if (x + width > FRAMEBUFFER_X_PIXELS)
+    if (x + width > (int16_t)FRAMEBUFFER_X_PIXELS)
     {
         obj_end_x = FRAMEBUFFER_X_PIXELS - x;
     }
@@ -344,7 +609,7 @@ void framebuffer_blit (int8_t x, int8_t y, uint8_t width, uint8_t height, const
         fb_start_row = FRAMEBUFFER_MIN_Y;
     }
 
-    if (y + height >= FRAMEBUFFER_Y_PIXELS)
+    if (y + height >= (int16_t)FRAMEBUFFER_Y_PIXELS)
     {
         obj_last_row = (FRAMEBUFFER_Y_PIXELS - y) >> 3;
         fb_rows = ((FRAMEBUFFER_MAX_Y) >> 3) - fb_start_row + 1;
@@ -355,6 +620,12 @@ void framebuffer_blit (int8_t x, int8_t y, uint8_t width, uint8_t height, const
         fb_rows = ((y + height - 1) >> 3) - fb_start_row + 1;
     }
 
+    if (linesLocked(fb_start_row, fb_start_row + fb_rows - 1))
+    {
+        // Some of the lines are being sent to the display
+        return false;
+    }
+
     // Iterate over all visible rows and copy relevant data to the framebuffer.
     for (i=fb_start_row; i<fb_start_row + fb_rows; i++)
     {
@@ -399,14 +670,20 @@ void framebuffer_blit (int8_t x, int8_t y, uint8_t width, uint8_t height, const
 
     updateDirtyArea(fb_start_x, fb_start_row,
                     fb_start_x + obj_end_x - 1, fb_start_row + fb_rows - 1);
+    return true;
 }
 
 void framebuffer_lock(void)
 {
-    self.isLocked = true;
+    self.lockedLines = ALL_LINES;
 }
 
 void framebuffer_unlock(void)
 {
-    self.isLocked = false;
+    self.lockedLines = 0;
+}
+
+void framebuffer_unlockLines(uint32_t lines)
+{
+    self.lockedLines &= ~lines;
 }
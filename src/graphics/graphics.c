@@ -1,111 +1,522 @@
-/*
- * Graphics library for small, monochrome displays (max size 255*255 pixels)
- *
- * Copyright (c) 2015-2021. BlueZephyr
- */
-
-#include <ssd1306.h>
-#include <framebuffer.h>
-#include "graphics.h"
-
-enum graphics_state_t
-{
-    state_init,
-    state_wait_for_show_request,
-    state_clear_display,
-    state_data_sent
-};
-
-/*
- * Internal variables for the graphics library
- */
-static struct graphics_t
-{
-    enum graphics_state_t state;
-    enum ssd1306_result_t displayResult;
-    bool showRequested;
-    bool operationOngoing;
-} self;
-
-void graphics_init(uint8_t taskId)
-{
-    self.state = state_init;
-    self.displayResult = ssd1306_result_ok;
-    self.showRequested = false;
-    self.operationOngoing = false;
-}
-
-void graphics_run (void)
-{
-    uint8_t *dirtyBuffer;
-    uint16_t dirtyBufferLen;
-    uint8_t dirtyBufferFirstLine;
-
-    if (self.operationOngoing)
-    {
-        if (self.displayResult == ssd1306_result_processing)
-        {
-            // Wait until the operation has finished
-            return;
-        }
-        else
-        {
-            self.operationOngoing = false;
-        }
-    }
-
-    switch (self.state)
-    {
-        case state_init:
-            if (ssd1306_initDisplay(&self.displayResult) == ssd1306_request_ok)
-            {
-                ssd1306_setMemoryAddressingMode(ssd1306_addressing_horizontal);
-                self.operationOngoing = true;
-                self.state = state_clear_display;
-            }
-            break;
-        case state_clear_display:
-            // Clear framebuffer and send to display
-            dirtyBuffer = framebuffer_getDirtyAreaBuffer(&dirtyBufferFirstLine, &dirtyBufferLen);
-
-            // Set start position
-            ssd1306_setPageAddress(0, 7);
-            ssd1306_setColumnAddress(0, 127);
-
-            if (ssd1306_sendGraphicsData(dirtyBuffer, dirtyBufferLen, &self.displayResult) == ssd1306_request_ok)
-            {
-                self.operationOngoing = true;
-                self.state = state_wait_for_show_request;
-            }
-            break;
-        case state_wait_for_show_request:
-            if (self.showRequested)
-            {
-                dirtyBuffer = framebuffer_getDirtyAreaBuffer(&dirtyBufferFirstLine, &dirtyBufferLen);
-
-                // Set start position
-                ssd1306_setPageAddress(dirtyBufferFirstLine, 7);
-                ssd1306_setColumnAddress(0, 127);
-
-                // Send data
-                if (ssd1306_sendGraphicsData(dirtyBuffer, dirtyBufferLen, &self.displayResult) == ssd1306_request_ok)
-                {
-                    self.operationOngoing = true;
-                    self.state = state_data_sent;
-                }
-            }
-            break;
-        case state_data_sent:
-            framebuffer_unlock();
-            self.state = state_wait_for_show_request;
-            self.showRequested = false;
-            break;
-    }
-}
-
-void graphics_show (void)
-{
-    framebuffer_lock();
-    self.showRequested = true;
-}
-
+/*
+ * Graphics library for small, monochrome displays (max size 255*255 pixels)
+ *
+ * Copyright (c) 2015-2021. BlueZephyr
+ */
+
+#include <ssd1306.h>
+#include <framebuffer.h>
+#include <flush_planner.h>
+#include "graphics.h"
+
+/*
+ * Max number of pages (lines of segments) in the framebuffer
+ */
+#define GRAPHICS_MAX_PAGES ((FRAMEBUFFER_Y_PIXELS + 7u) / 8u)
+
+/*
+ * The framebuffer can span several panels that are placed side by side. Panel n
+ * shows the columns from n*GRAPHICS_PANEL_WIDTH and is SSD1306 display n.
+ */
+#if ((GRAPHICS_PANELS < 1u) || (GRAPHICS_PANELS > 8u))
+#error "GRAPHICS_PANELS must be between 1 and 8"
+#endif
+#if (FRAMEBUFFER_X_PIXELS % GRAPHICS_PANELS != 0)
+#error "FRAMEBUFFER_X_PIXELS must be a multiple of GRAPHICS_PANELS"
+#endif
+#define GRAPHICS_PANEL_WIDTH (FRAMEBUFFER_X_PIXELS / GRAPHICS_PANELS)
+#define GRAPHICS_ALL_PANELS ((uint8_t)((1u << GRAPHICS_PANELS) - 1u))
+
+#if (GRAPHICS_PAGE_FLIP)
+/*
+ * With page flipping, the display RAM (8 pages) holds two frames. The frame is
+ * written to the hidden half and then shown by moving the display start line.
+ */
+#if (FRAMEBUFFER_Y_PIXELS > 32u)
+#error "GRAPHICS_PAGE_FLIP requires a panel with at most 32 rows"
+#endif
+#define GRAPHICS_FLIP_PAGES 4u
+#endif
+
+/*
+ * Max number of areas that are updated in a frame (see flush_planner.h). With
+ * page flipping, the areas updated in the previous frame are sent as well.
+ */
+#define GRAPHICS_FRAME_AREAS FLUSH_PLANNER_MAX_AREAS
+#if (GRAPHICS_PAGE_FLIP)
+#define GRAPHICS_MAX_AREAS (2u * GRAPHICS_FRAME_AREAS)
+#else
+#define GRAPHICS_MAX_AREAS GRAPHICS_FRAME_AREAS
+#endif
+
+enum graphics_state_t
+{
+    state_init,
+    state_wait_for_show_request,
+    state_send_frame,
+    state_clear_display,
+    state_flip_display,
+    state_data_sent
+};
+
+/*
+ * Internal variables for the graphics library
+ */
+static struct graphics_t
+{
+    enum graphics_state_t state;
+    enum ssd1306_result_t displayResult[GRAPHICS_PANELS];
+    bool showRequested;
+    bool operationOngoing;
+    uint8_t panelsPending;      // Panels that the current operation is not yet requested for
+    struct framebuffer_area_t areas[GRAPHICS_MAX_AREAS];    // Areas of the frame, sent one at a time
+    uint8_t areaCount;
+    uint8_t areaIndex;          // Next area to send
+    struct framebuffer_area_t area[GRAPHICS_PANELS];    // Part of the area on each panel (in
+                                                        // framebuffer columns)
+    struct ssd1306_data_span_t spans[GRAPHICS_PANELS][GRAPHICS_MAX_PAGES];
+#if (GRAPHICS_PAGE_FLIP)
+    enum graphics_state_t stateAfterFlip;
+    bool flipPending;
+    uint8_t hiddenPage;         // First page of the hidden half
+    bool lastDamageValid;
+    uint8_t lastDamageCount;    // Areas updated in the previous frame
+    struct framebuffer_area_t lastDamage[GRAPHICS_FRAME_AREAS];
+#endif
+} self;
+
+/*
+ * Local function prototypes
+ */
+static bool operationOngoing(void);
+static bool initPanels(void);
+static bool sendDirtyArea(void);
+static void splitArea(const struct framebuffer_area_t *area);
+static bool sendPanelArea(uint8_t panel);
+static void unlockSentLines(void);
+static uint32_t unsentLines(const struct framebuffer_area_t *area);
+#if (GRAPHICS_PAGE_FLIP)
+static void addLastDamage(void);
+static bool areaContains(const struct framebuffer_area_t *outer, const struct framebuffer_area_t *inner);
+static bool flipPanels(void);
+#endif
+
+void graphics_init(uint8_t taskId)
+{
+    (void)taskId;
+    self.state = state_init;
+    for (uint8_t panel=0; panel<GRAPHICS_PANELS; panel++)
+    {
+        self.displayResult[panel] = ssd1306_result_ok;
+    }
+    self.showRequested = false;
+    self.operationOngoing = false;
+    self.panelsPending = GRAPHICS_ALL_PANELS;
+    self.areaCount = 0;
+    self.areaIndex = 0;
+    flush_planner_init();
+#if (GRAPHICS_PAGE_FLIP)
+    self.stateAfterFlip = state_wait_for_show_request;
+    self.flipPending = false;
+    self.hiddenPage = GRAPHICS_FLIP_PAGES;
+    self.lastDamageValid = false;
+#endif
+}
+
+void graphics_run (void)
+{
+    if (self.operationOngoing)
+    {
+        if (operationOngoing())
+        {
+            // Wait until the operation has finished on all panels
+            unlockSentLines();
+            return;
+        }
+        else
+        {
+            self.operationOngoing = false;
+        }
+    }
+
+    switch (self.state)
+    {
+        case state_init:
+            if (initPanels())
+            {
+                self.state = state_clear_display;
+            }
+            break;
+        case state_clear_display:
+            // Send the cleared framebuffer (all of it is dirty after init)
+            if (sendDirtyArea())
+            {
+#if (GRAPHICS_PAGE_FLIP)
+                self.stateAfterFlip = state_wait_for_show_request;
+                self.state = state_flip_display;
+#else
+                self.state = state_wait_for_show_request;
+#endif
+            }
+            break;
+        case state_wait_for_show_request:
+            if (!self.showRequested)
+            {
+                break;
+            }
+            // A new show request can be made while the frame is sent when the
+            // framebuffer is double buffered
+            self.showRequested = false;
+            self.state = state_send_frame;
+            // Fall through
+        case state_send_frame:
+            if (sendDirtyArea())
+            {
+#if (GRAPHICS_PAGE_FLIP)
+                self.stateAfterFlip = state_data_sent;
+                self.state = state_flip_display;
+#else
+                self.state = state_data_sent;
+#endif
+            }
+            break;
+        case state_flip_display:
+#if (GRAPHICS_PAGE_FLIP)
+            // The data has been written to the hidden half. Show it.
+            if (!self.flipPending || flipPanels())
+            {
+                self.state = self.stateAfterFlip;
+            }
+#endif
+            break;
+        case state_data_sent:
+            if (!self.showRequested)
+            {
+                // Keep the framebuffer locked if the next frame has been requested
+                framebuffer_unlock();
+            }
+            self.state = state_wait_for_show_request;
+            break;
+    }
+}
+
+void graphics_show (void)
+{
+#if !(FRAMEBUFFER_DOUBLE_BUFFER)
+    framebuffer_lock();
+#endif
+    self.showRequested = true;
+}
+
+/*
+ * Returns true if an operation is still processing on any of the panels.
+ */
+static bool operationOngoing(void)
+{
+    for (uint8_t panel=0; panel<GRAPHICS_PANELS; panel++)
+    {
+        if (self.displayResult[panel] == ssd1306_result_processing)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Request the init of the panels that have not been requested yet. Returns true
+ * when all panels have been requested.
+ */
+static bool initPanels(void)
+{
+    for (uint8_t panel=0; panel<GRAPHICS_PANELS; panel++)
+    {
+        if ((self.panelsPending & (1u << panel)) &&
+            (ssd1306_initDisplayOn(panel, &self.displayResult[panel]) == ssd1306_request_ok))
+        {
+            ssd1306_setMemoryAddressingModeOn(panel, ssd1306_addressing_horizontal);
+            self.panelsPending &= ~(1u << panel);
+            self.operationOngoing = true;
+        }
+    }
+    return self.panelsPending == 0;
+}
+
+/*
+ * Send the modified parts of the framebuffer to the display, one area at a time.
+ * The flush planner chooses the areas that are cheapest to send, e.g., areas far
+ * apart are sent separately, so only the modified parts are sent.
+ * Each area is split on the panels that it covers, and the part on each panel
+ * is sent to that panel only. The transfers to the panels are requested
+ * together, and the display driver interleaves them. Returns true if the last
+ * area is being sent to all panels or if there was nothing to send.
+ *
+ * With page flipping, the data is written to the hidden half of the display RAM.
+ * The hidden half holds the frame before the one that is shown, so the areas
+ * that were updated in the previous frame are sent as well.
+ *
+ * The lines of the framebuffer are unlocked as they are sent and are not part of
+ * the remaining areas (see unlockSentLines).
+ */
+static bool sendDirtyArea(void)
+{
+    if (self.panelsPending == 0)
+    {
+        if (self.areaIndex >= self.areaCount)
+        {
+            // Start sending a new frame
+            if (!framebuffer_isDirty())
+            {
+                return true;
+            }
+            (void)flush_planner_plan(self.areas, &self.areaCount);
+#if (FRAMEBUFFER_DOUBLE_BUFFER)
+            // The frame is sent from the front buffer, and drawing continues
+            // in the back buffer
+            framebuffer_copyToFront();
+#endif
+            self.areaIndex = 0;
+            framebuffer_clearDirty();
+#if (GRAPHICS_PAGE_FLIP)
+            addLastDamage();
+            self.flipPending = true;
+#endif
+        }
+        unlockSentLines();
+        splitArea(&self.areas[self.areaIndex]);
+        self.areaIndex++;
+    }
+
+    for (uint8_t panel=0; panel<GRAPHICS_PANELS; panel++)
+    {
+        if ((self.panelsPending & (1u << panel)) && sendPanelArea(panel))
+        {
+            self.panelsPending &= ~(1u << panel);
+            self.operationOngoing = true;
+        }
+    }
+    return (self.panelsPending == 0) && (self.areaIndex >= self.areaCount);
+}
+
+/*
+ * Split the area on the panels that it covers.
+ */
+static void splitArea(const struct framebuffer_area_t *area)
+{
+    for (uint8_t panel = area->xStart / GRAPHICS_PANEL_WIDTH; panel <= area->xEnd / GRAPHICS_PANEL_WIDTH; panel++)
+    {
+        uint8_t panelStart = panel * GRAPHICS_PANEL_WIDTH;
+        uint8_t panelEnd = panelStart + GRAPHICS_PANEL_WIDTH - 1;
+
+        self.area[panel].xStart = (area->xStart > panelStart) ? area->xStart : panelStart;
+        self.area[panel].xEnd = (area->xEnd < panelEnd) ? area->xEnd : panelEnd;
+        self.area[panel].yStart = area->yStart;
+        self.area[panel].yEnd = area->yEnd;
+        self.panelsPending |= (1u << panel);
+    }
+}
+
+/*
+ * Send the area of the panel. The part of each line in the area is sent
+ * directly from the framebuffer as one span. If the area covers whole lines,
+ * the lines are contiguous in the framebuffer and are sent as one span.
+ * Returns true if the data is being sent.
+ */
+static bool sendPanelArea(uint8_t panel)
+{
+    const struct framebuffer_area_t *area = &self.area[panel];
+    struct ssd1306_data_span_t *spans = self.spans[panel];
+    uint8_t panelStart = panel * GRAPHICS_PANEL_WIDTH;
+    uint16_t width = area->xEnd - area->xStart + 1;
+    uint8_t spanCount = 0;
+
+    for (uint8_t line = area->yStart; line <= area->yEnd; line++)
+    {
+        const uint8_t *segments = framebuffer_getSegments(area->xStart, line);
+
+        if ((spanCount > 0) &&
+            (spans[spanCount - 1].data + spans[spanCount - 1].len == segments))
+        {
+            // Contiguous with the previous line
+            spans[spanCount - 1].len += width;
+        }
+        else
+        {
+            spans[spanCount].data = segments;
+            spans[spanCount].len = width;
+            spanCount++;
+        }
+    }
+
+    ssd1306_setColumnAddressOn(panel, area->xStart - panelStart, area->xEnd - panelStart);
+#if (GRAPHICS_PAGE_FLIP)
+    ssd1306_setPageAddressOn(panel, self.hiddenPage + area->yStart, self.hiddenPage + area->yEnd);
+#else
+    ssd1306_setPageAddressOn(panel, area->yStart, area->yEnd);
+#endif
+    return ssd1306_sendGraphicsSpansOn(panel, spans, spanCount, &self.displayResult[panel]) == ssd1306_request_ok;
+}
+
+/*
+ * Unlock the lines of the framebuffer that have been sent and are not in any of
+ * the areas that are still to be sent, so drawing can continue on them while
+ * the rest of the frame is sent. The lines of the area that is being sent are
+ * unlocked as the panels receive them (see unsentLines). The lines stay locked
+ * if a new show request has been made.
+ */
+static void unlockSentLines(void)
+{
+    uint32_t pendingLines = 0;
+
+    if (self.showRequested)
+    {
+        return;
+    }
+    if (self.areaIndex > 0)
+    {
+        pendingLines = unsentLines(&self.areas[self.areaIndex - 1]);
+    }
+    for (uint8_t i=self.areaIndex; i<self.areaCount; i++)
+    {
+        for (uint8_t line=self.areas[i].yStart; line<=self.areas[i].yEnd; line++)
+        {
+            pendingLines |= ((uint32_t)1u << line);
+        }
+    }
+    framebuffer_unlockLines(~pendingLines);
+}
+
+/*
+ * Get the lines of the area that have not been received by all the panels that
+ * it covers. The area is sent line by line, so a panel has received the lines
+ * that its data progress (see ssd1306_getDataProgressOn) covers in full.
+ */
+static uint32_t unsentLines(const struct framebuffer_area_t *area)
+{
+    uint8_t sentLines = area->yEnd - area->yStart + 1;
+    uint32_t lines = 0;
+
+    for (uint8_t panel = area->xStart / GRAPHICS_PANEL_WIDTH; panel <= area->xEnd / GRAPHICS_PANEL_WIDTH; panel++)
+    {
+        uint16_t width = self.area[panel].xEnd - self.area[panel].xStart + 1;
+        uint8_t panelLines;
+
+        if (self.panelsPending & (1u << panel))
+        {
+            // Not requested yet
+            panelLines = 0;
+        }
+        else if (self.displayResult[panel] == ssd1306_result_processing)
+        {
+            panelLines = ssd1306_getDataProgressOn(panel) / width;
+        }
+        else
+        {
+            continue;
+        }
+        if (panelLines < sentLines)
+        {
+            sentLines = panelLines;
+        }
+    }
+    for (uint8_t line=area->yStart + sentLines; line<=area->yEnd; line++)
+    {
+        lines |= ((uint32_t)1u << line);
+    }
+    return lines;
+}
+
+#if (GRAPHICS_PAGE_FLIP)
+/*
+ * Add the areas that were updated in the previous frame to the areas of the
+ * frame, and drop the areas that are covered by another area. The first time,
+ * the whole hidden half is written.
+ */
+static void addLastDamage(void)
+{
+    bool covered[GRAPHICS_MAX_AREAS];
+    uint8_t damageCount = self.areaCount;
+    uint8_t count = 0;
+
+    if (!self.lastDamageValid)
+    {
+        // The hidden half has not been written yet
+        self.areas[0].xStart = 0;
+        self.areas[0].xEnd = FRAMEBUFFER_X_PIXELS - 1;
+        self.areas[0].yStart = 0;
+        self.areas[0].yEnd = GRAPHICS_MAX_PAGES - 1;
+        self.areaCount = 1;
+        self.lastDamage[0] = self.areas[0];
+        self.lastDamageCount = 1;
+        self.lastDamageValid = true;
+        return;
+    }
+
+    for (uint8_t i=0; i<self.lastDamageCount; i++)
+    {
+        self.areas[self.areaCount++] = self.lastDamage[i];
+    }
+    for (uint8_t i=0; i<damageCount; i++)
+    {
+        self.lastDamage[i] = self.areas[i];
+    }
+    self.lastDamageCount = damageCount;
+
+    // Of two equal areas, the first one is kept
+    for (uint8_t i=0; i<self.areaCount; i++)
+    {
+        covered[i] = false;
+        for (uint8_t j=0; j<self.areaCount; j++)
+        {
+            if ((j != i) && areaContains(&self.areas[j], &self.areas[i]) &&
+                ((j < i) || !areaContains(&self.areas[i], &self.areas[j])))
+            {
+                covered[i] = true;
+            }
+        }
+    }
+    for (uint8_t i=0; i<self.areaCount; i++)
+    {
+        if (!covered[i])
+        {
+            self.areas[count++] = self.areas[i];
+        }
+    }
+    self.areaCount = count;
+}
+
+static bool areaContains(const struct framebuffer_area_t *outer, const struct framebuffer_area_t *inner)
+{
+    return (outer->xStart <= inner->xStart) && (inner->xEnd <= outer->xEnd) &&
+           (outer->yStart <= inner->yStart) && (inner->yEnd <= outer->yEnd);
+}
+
+/*
+ * Move the display start line of all panels to the hidden half. All panels are
+ * flipped, also those that got no data, since the halves only differ within the
+ * area that was sent. Returns true when all panels have been requested.
+ */
+static bool flipPanels(void)
+{
+    if (self.panelsPending == 0)
+    {
+        self.panelsPending = GRAPHICS_ALL_PANELS;
+    }
+    for (uint8_t panel=0; panel<GRAPHICS_PANELS; panel++)
+    {
+        if ((self.panelsPending & (1u << panel)) &&
+            (ssd1306_setDisplayStartLineOn(panel, self.hiddenPage * 8u, &self.displayResult[panel]) == ssd1306_request_ok))
+        {
+            self.panelsPending &= ~(1u << panel);
+            self.operationOngoing = true;
+        }
+    }
+    if (self.panelsPending != 0)
+    {
+        return false;
+    }
+    self.hiddenPage = (self.hiddenPage == 0) ? GRAPHICS_FLIP_PAGES : 0;
+    self.flipPending = false;
+    return true;
+}
+#endif
@@ -10,6 +10,7 @@
 
 #include "hmc5883l.h"
 #include "hal/i2c.h"
+#include "i2c_arbiter.h"
 
 #ifdef DEBUG
 #include <core/uart.h>
@@ -77,6 +78,7 @@ enum hmc_state_t
 static struct hmc_5883l_t
 {
     uint8_t taskId;
+    uint8_t i2cClient;
     uint8_t cra;
     uint8_t crb;
     uint8_t configurationStatus;
@@ -93,6 +95,7 @@ static struct hmc_5883l_t
 void hmc_init(uint8_t taskId)
 {
     self.taskId = taskId;
+    self.i2cClient = i2c_arbiter_addClient(I2C_ARBITER_PRIORITY_HMC5883L);
     self.cra = 0;
     self.crb = 0;
     self.configurationStatus = 0;
@@ -110,8 +113,8 @@ void hmc_task_run(void)
             return;
         case hmc_state_send_cra:
             self.i2c_buffer[0] = self.cra;
-            if (i2c_masterTransmitRegister(HMC5883L_ADDRESS, HMC5883L_CONFIG_A, self.i2c_buffer,
-                                           1, &self.i2cResult) == i2c_request_ok)
+            if (i2c_arbiter_transmitRegister(self.i2cClient, HMC5883L_ADDRESS, HMC5883L_CONFIG_A,
+                                             self.i2c_buffer, 1, &self.i2cResult) == i2c_request_ok)
             {
                 self.state = hmc_state_wait_send_cra_done;
             }
@@ -124,8 +127,8 @@ void hmc_task_run(void)
             break;
         case hmc_state_send_crb:
             self.i2c_buffer[0] = self.crb;
-            if (i2c_masterTransmitRegister(HMC5883L_ADDRESS, HMC5883L_CONFIG_B, self.i2c_buffer,
-                                           1, &self.i2cResult) == i2c_request_ok)
+            if (i2c_arbiter_transmitRegister(self.i2cClient, HMC5883L_ADDRESS, HMC5883L_CONFIG_B,
+                                             self.i2c_buffer, 1, &self.i2cResult) == i2c_request_ok)
             {
                 self.state = hmc_state_wait_send_crb_done;
             }
@@ -138,8 +141,8 @@ void hmc_task_run(void)
             break;
         case hmc_state_send_single_measurement_mode:
             self.i2c_buffer[0] = (1 << MD1);
-            if (i2c_masterTransmitRegister(HMC5883L_ADDRESS, HMC5883L_MODE, self.i2c_buffer,
-                                           1, &self.i2cResult) == i2c_request_ok)
+            if (i2c_arbiter_transmitRegister(self.i2cClient, HMC5883L_ADDRESS, HMC5883L_MODE,
+                                             self.i2c_buffer, 1, &self.i2cResult) == i2c_request_ok)
             {
                 self.state = hmc_state_wait_send_single_measurement_mode;
             }
@@ -151,8 +154,8 @@ void hmc_task_run(void)
             }
             break;
         case hmc_state_read_measurement_registers:
-            if (i2c_read_register(HMC5883L_ADDRESS, HMC5883L_DATA_X_MSB, self.i2c_buffer,
-                                  HMC_I2C_BUFFER_LEN, &self.i2cResult) == i2c_request_ok)
+            if (i2c_arbiter_readRegister(self.i2cClient, HMC5883L_ADDRESS, HMC5883L_DATA_X_MSB,
+                                         self.i2c_buffer, HMC_I2C_BUFFER_LEN, &self.i2cResult) == i2c_request_ok)
             {
                 self.state = hmc_state_wait_read_measurement_registers;
             }
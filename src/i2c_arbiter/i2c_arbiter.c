@@ -0,0 +1,212 @@
+/*
+ * Arbiter for a shared I2C bus.
+ *
+ * Copyright (c) 2021. BlueZephyr
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ *
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "i2c_arbiter.h"
+
+/*
+ * Local function prototypes
+ */
+static bool knownClient(uint8_t client);
+static bool requestGranted(uint8_t client);
+static bool hasPrecedence(uint8_t client, uint8_t other);
+static void updateClient(uint8_t client, bool granted, enum i2c_op_result_t *result);
+
+struct i2c_arbiter_client_t
+{
+    bool used;
+    uint8_t priority;
+    bool waiting;
+    uint8_t waitCount;
+};
+
+/*
+ * Internal variables for the arbiter
+ */
+static struct i2c_arbiter_t
+{
+    struct i2c_arbiter_client_t clients[I2C_ARBITER_MAX_CLIENTS];
+    enum i2c_op_result_t *inFlightResult;
+} self;
+
+/*
+ * Public functions
+ */
+void i2c_arbiter_init(void)
+{
+    for (uint8_t client=0; client<I2C_ARBITER_MAX_CLIENTS; client++)
+    {
+        self.clients[client].used = false;
+        self.clients[client].waiting = false;
+    }
+    self.inFlightResult = NULL;
+}
+
+uint8_t i2c_arbiter_addClient(uint8_t priority)
+{
+    for (uint8_t client=0; client<I2C_ARBITER_MAX_CLIENTS; client++)
+    {
+        if (!self.clients[client].used)
+        {
+            self.clients[client].used = true;
+            self.clients[client].priority = priority;
+            self.clients[client].waiting = false;
+            self.clients[client].waitCount = 0;
+            return client;
+        }
+    }
+    return I2C_ARBITER_NO_CLIENT;
+}
+
+void i2c_arbiter_removeClient(uint8_t client)
+{
+    if (knownClient(client))
+    {
+        self.clients[client].used = false;
+        self.clients[client].waiting = false;
+    }
+}
+
+void i2c_arbiter_cancel(uint8_t client)
+{
+    if (knownClient(client))
+    {
+        self.clients[client].waiting = false;
+        self.clients[client].waitCount = 0;
+    }
+}
+
+enum i2c_request_t
+i2c_arbiter_transmit(uint8_t client, uint8_t address, const uint8_t *buffer,
+                     uint16_t length, enum i2c_op_result_t *result)
+{
+    bool granted = false;
+
+    if (requestGranted(client))
+    {
+        granted = i2c_masterTransmit(address, buffer, length, result) == i2c_request_ok;
+    }
+    updateClient(client, granted, result);
+    return granted ? i2c_request_ok : i2c_request_busy;
+}
+
+enum i2c_request_t
+i2c_arbiter_transmitRegister(uint8_t client, uint8_t address, uint8_t reg,
+                             const uint8_t *buffer, uint16_t length,
+                             enum i2c_op_result_t *result)
+{
+    bool granted = false;
+
+    if (requestGranted(client))
+    {
+        granted = i2c_masterTransmitRegister(address, reg, buffer, length, result) == i2c_request_ok;
+    }
+    updateClient(client, granted, result);
+    return granted ? i2c_request_ok : i2c_request_busy;
+}
+
+enum i2c_request_t
+i2c_arbiter_readRegister(uint8_t client, uint8_t address, uint8_t read_register,
+                         uint8_t *buffer, uint16_t length, enum i2c_op_result_t *result)
+{
+    bool granted = false;
+
+    if (requestGranted(client))
+    {
+        granted = i2c_read_register(address, read_register, buffer, length, result) == i2c_request_ok;
+    }
+    updateClient(client, granted, result);
+    return granted ? i2c_request_ok : i2c_request_busy;
+}
+
+/*
+ * Local functions
+ */
+
+static bool knownClient(uint8_t client)
+{
+    return (client < I2C_ARBITER_MAX_CLIENTS) && self.clients[client].used;
+}
+
+/*
+ * Check if the client may use the bus. The bus must be free and no other
+ * waiting client may have precedence.
+ */
+static bool requestGranted(uint8_t client)
+{
+    uint8_t other;
+
+    if ((self.inFlightResult != NULL) && (*self.inFlightResult == i2c_operation_processing))
+    {
+        return false;
+    }
+    if (!knownClient(client))
+    {
+        // Unknown client - no reservations
+        return true;
+    }
+    for (other = 0; other < I2C_ARBITER_MAX_CLIENTS; other++)
+    {
+        if ((other != client) && self.clients[other].waiting && hasPrecedence(other, client))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Returns true if the client shall get the bus before the other client.
+ */
+static bool hasPrecedence(uint8_t client, uint8_t other)
+{
+    bool clientOverdue = self.clients[client].waitCount >= I2C_ARBITER_LATENCY_BOUND;
+    bool otherOverdue = self.clients[other].waitCount >= I2C_ARBITER_LATENCY_BOUND;
+
+    if (clientOverdue != otherOverdue)
+    {
+        return clientOverdue;
+    }
+    if (self.clients[client].priority != self.clients[other].priority)
+    {
+        return self.clients[client].priority > self.clients[other].priority;
+    }
+    return self.clients[client].waitCount > self.clients[other].waitCount;
+}
+
+/*
+ * Update the reservation of the client after a request. A granted client
+ * releases its reservation and the bus is busy until its operation is done.
+ */
+static void updateClient(uint8_t client, bool granted, enum i2c_op_result_t *result)
+{
+    if (granted)
+    {
+        self.inFlightResult = result;
+    }
+    if (!knownClient(client))
+    {
+        return;
+    }
+    if (granted)
+    {
+        self.clients[client].waiting = false;
+        self.clients[client].waitCount = 0;
+    }
+    else
+    {
+        self.clients[client].waiting = true;
+        if (self.clients[client].waitCount < UINT8_MAX)
+        {
+            self.clients[client].waitCount++;
+        }
+    }
+}
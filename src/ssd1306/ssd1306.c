@@ -11,45 +11,120 @@
  */
 
 #include <stdio.h>
+#include <string.h>
+#include "hal/timer.h"
 #include "ssd1306.h"
 #include "ssd1306_defines.h"
 #include "config/ssd1306_config.h"
 
 /*
- * Com functions - to be moved to separate module
+ * Bus used to communicate with the display
  */
+#if (SSD1306_BUS == SSD1306_BUS_SPI)
+#include "hal/spi.h"
+#define BUS_RESULT_T                enum spi_op_result_t
+#define BUS_OPERATION_OK            spi_operation_ok
+#define BUS_OPERATION_PROCESSING    spi_operation_processing
+#else
 #include "hal/i2c.h"
+#include "i2c_arbiter.h"
+#define BUS_RESULT_T                enum i2c_op_result_t
+#define BUS_OPERATION_OK            i2c_operation_ok
+#define BUS_OPERATION_PROCESSING    i2c_operation_processing
+#endif
 
-#define INIT_DELAY_TIME 100u
+#if ((SSD1306_HEIGHT < SSD1306_MUX_MIN_VALUE) || (SSD1306_HEIGHT > SSD1306_MUX_MAX_VALUE) || \
+     (SSD1306_HEIGHT % 8u != 0))
+#error "SSD1306_HEIGHT must be a multiple of 8 between 16 and 64"
+#endif
+#if (SSD1306_WIDTH + SSD1306_COLUMN_OFFSET > SSD1306_GDDRAM_COLUMNS)
+#error "SSD1306_WIDTH and SSD1306_COLUMN_OFFSET do not fit in the display RAM"
+#endif
+
+/*
+ * Position of the multiplex ratio (the panel height) in the init sequence
+ */
+#define INIT_SEQUENCE_MUX_INDEX     1u
+
+/*
+ * Settings in the shadow of the controller's configuration
+ */
+#define SHADOW_CONTRAST             (1u << 0)
+#define SHADOW_DISPLAY_ON           (1u << 1)
+#define SHADOW_INVERTED             (1u << 2)
+#define SHADOW_ENTIRE_DISPLAY_ON    (1u << 3)
+#define SHADOW_ADDRESSING_MODE      (1u << 4)
+#define SHADOW_WINDOW               (1u << 5)
+#define SHADOW_PAGE_POINTER         (1u << 6)
+#define SHADOW_SCROLL               (1u << 7)
+#define SHADOW_ORIENTATION          (1u << 8)
+#define SHADOW_FADE                 (1u << 9)
+#define SHADOW_ZOOM                 (1u << 10)
+
+#if (SSD1306_GDDRAM_SHADOW)
+/*
+ * Number of bytes that it costs to start a new transfer at another position in
+ * the display RAM: the commands that move the RAM pointer plus the overhead of
+ * the extra command and data transfers (address and control byte). Unchanged
+ * gaps shorter than this are sent instead of moving the pointer.
+ */
+#define GDDRAM_REWINDOW_COST_PAGE_MODE  (3u + 2u + 2u)
+#define GDDRAM_REWINDOW_COST_WINDOW     (6u + 2u + 2u)
+#define GDDRAM_SIZE                     (SSD1306_WIDTH * SSD1306_GDDRAM_PAGES)
+#endif
 
 /*
  * Local function prototypes
  */
-static void initDisplay(void);
-static void sendData(void);
-static void createSingleCommand(uint8_t command, uint8_t length);
-static enum ssd1306_request_t createSingleCommandRequest(enum ssd1306_result_t *result);
-static void prepareSetMultiPlexRatioCommand(uint8_t ratio);
-static void prepareSetDisplayOffset (uint8_t offset);
-static void prepareSetContrast(uint8_t level);
-static void prepareSetPixelsFromRAM(void);
-static void prepareSetPixelsEntireDisplayOn(void);
-static void prepareSetNormalDisplay(void);
-static void prepareSetInvertedDisplay(void);
-static void prepareSetDisplayOn(void);
-static void prepareSetDisplaySleep(void);
-static void prepareSetAddressingMode(uint8_t mode);
-static void prepareSetColumnAddress(void);
-static void prepareSetPageAddress(void);
-static void prepareSetDisplayStartLine(uint8_t line);
-static void prepareSetSegmentRemap_0(void);
-static void prepareSetSegmentRemap_127(void);
-static void prepareSetComOutputScanDirectionNormal(void);
-static void prepareSetComOutputScanDirectionRemapped(void);
-static void prepareSetComPinsHardwareConfig(bool useAltComPinConf, bool enableLeftRightRemap);
-static void prepareSetDisplayClock(uint8_t divideRatio, uint8_t oscillatorFrequency);
-static void prepareEnableChargePump(void);
-static void prepareDisableChargePump(void);
+static bool runDisplay(void);
+static bool useDisplay(uint8_t display);
+static bool runStep(void);
+static bool queuedCommandsAllowed(void);
+static bool validGeometry(uint8_t width, uint8_t height, uint8_t columnOffset);
+static bool waitingForDelay(void);
+static bool deadlineReached(uint32_t deadline);
+static bool busTransmit(uint8_t control, const uint8_t *buffer, uint16_t length);
+#if (SSD1306_BUS == SSD1306_BUS_SPI)
+static bool spiTransferOngoing(void);
+#endif
+static bool initDisplay(void);
+static bool sendData(void);
+static void appendCommand(const uint8_t *command, uint8_t length);
+static enum ssd1306_request_t queueCommand(const uint8_t *command, uint8_t length, enum ssd1306_result_t *result);
+static bool sendQueuedCommands(void);
+static void completeQueuedCommands(enum ssd1306_result_t result);
+static bool handleTransferError(void);
+static bool transferNotStarted(void);
+static void resumeData(void);
+static void failOperation(void);
+static enum ssd1306_request_t queueSetting(uint16_t setting, uint8_t *shadowValue, uint8_t value,
+                                           const uint8_t *command, uint8_t length,
+                                           enum ssd1306_result_t *result);
+static void setInitShadow(void);
+static enum ssd1306_request_t queueOrientationCommand(const uint8_t *command, enum ssd1306_result_t *result);
+static void segmentRemapQueued(void);
+static void prepareSetWindow(void);
+static void appendAddressingMode(void);
+static void appendWindow(uint8_t colStart, uint8_t colEnd, uint8_t pageStart, uint8_t pageEnd);
+static void appendPageHeader(uint8_t page, uint8_t column);
+static uint16_t windowSize(void);
+static void advanceRamPointer(uint16_t length);
+static void skipEmptySpans(void);
+static void advanceSpans(uint16_t length);
+#if (SSD1306_GDDRAM_SHADOW)
+static bool prepareNextChangedRun(void);
+static uint16_t findChangedRun(void);
+static uint16_t streamIndex(uint16_t offset);
+static uint16_t streamRowLeft(void);
+static void advanceStream(uint16_t length);
+static bool gddramDiffers(uint16_t index, uint8_t value);
+static void clearGddramShadow(void);
+#else
+static bool prepareNextChunk(void);
+static void prepareResume(void);
+static void seekSpans(uint16_t offset);
+static uint8_t windowWidth(void);
+#endif
 
 
 /*
@@ -58,7 +133,6 @@ static void prepareDisableChargePump(void);
 enum ssd1306_state_t
 {
     ssd1306_idle_state,
-    ssd1306_single_command_state,
     ssd1306_init_display_state,
     ssd1306_send_graphics_data_state
 };
@@ -67,22 +141,10 @@ enum ssd1306_operation_step_t
 {
     ssd1306_none_step,
     ssd1306_init_delay_step,
-    ssd1306_init_set_mux_ratio_step,
-    ssd1306_init_set_display_offset_step,
-    ssd1306_init_set_display_start_line_step,
-    ssd1306_init_set_segment_remap_step,
-    ssd1306_init_set_com_output_scan_direction_step,
-    ssd1306_init_set_com_pins_hardware_configuration_step,
-    ssd1306_init_set_contrast_step,
-    ssd1306_init_set_use_pixels_from_ram_step,
-    ssd1306_init_set_normal_display_step,
-    ssd1306_init_set_clock_divider_and_oscillator_step,
-    ssd1306_init_charge_pump_setting_step,
-    ssd1306_init_set_addressing_mode_step,
-    ssd1306_init_display_on_step,
+    ssd1306_init_send_sequence_step,
     ssd1306_init_done,
-    ssd1306_data_set_col_position_step,
-    ssd1306_data_set_page_position_step,
+    ssd1306_data_set_window_step,
+    ssd1306_data_resume_step,
     ssd1306_data_send_graphics_data_step,
     ssd1306_data_send_done
 };
@@ -91,15 +153,103 @@ enum ssd1306_command_t
 {
     no_command,
     single_command,
+    queued_commands,
+    init_sequence_command,
     send_data_command
 };
 
 /*
- * SSD1306 class (singleton)
+ * Init sequence sent to the display in one transaction after the power on delay.
+ * The values are taken from the config file. Each display keeps a copy with the
+ * multiplex ratio set to its height. The memory addressing mode is set
+ * to the configured default; if another mode has been requested, it is sent
+ * before the next graphics data.
+ */
+static const uint8_t initSequence[] =
+{
+    SSD1306_SET_MULTIPLEX_RATIO, SSD1306_HEIGHT - 1,
+    SSD1306_SET_DISPLAY_OFFSET, SSD1306_DEFAULT_DISPLAY_OFFSET,
+    SSD1306_SET_DISPLAY_START_LINE | SSD1306_DEFAULT_DISPLAY_STARTLINE,
+    SSD1306_SEGMENT_REMAP_127,
+    SSD1306_SET_COM_OUTPUT_SCAN_DIRECTION_REMAPPED,
+    SSD1306_SET_COM_PINS_HARDWARE_CONFIGURATION,
+    SSD1306_COM_PINS_HARDWARE_BASE_VALUE |
+        ((uint8_t)SSD1306_DEFAULT_COM_HW_PIN_USE_ALT_COM_PIN_CONF) << 4 |
+        ((uint8_t)SSD1306_DEFAULT_COM_HW_PIN_EN_LEFT_RIGHT_REMAP) << 5,
+    SSD1306_SET_CONTRAST, SSD1306_DEFAULT_CONTRAST,
+    SSD1306_SET_USE_PIXELS_FROM_RAM,
+    SSD1306_SET_NORMAL_DISPLAY,
+    SSD1306_SET_CLOCK_DIVIDER_AND_OSCILLATOR,
+    (SSD1306_DEFAULT_DISPLAY_CLOCK_DIVIDE_RATIO - 1) | (SSD1306_DEFAULT_OSCILLATOR_FREQUENCY << 4),
+    SSD1306_CHARGE_PUMP_SETTING, SSD1306_CHARGE_PUMP_ENABLE,
+    SSD1306_SET_MEMORY_ADDRESSING_MODE, SSD1306_DEFAULT_MEMORY_ADDRESSING_MODE,
+    SSD1306_DISPLAY_ON
+};
+
+/*
+ * Segment remap and COM scan direction for each orientation. The normal
+ * orientation is the one set by the init sequence.
  */
-static struct ssd1306_t
+static const uint8_t orientationCommands[][2] =
 {
-    uint8_t taskId;
+    [ssd1306_orientation_normal] = {SSD1306_SEGMENT_REMAP_127, SSD1306_SET_COM_OUTPUT_SCAN_DIRECTION_REMAPPED},
+    [ssd1306_orientation_rotated_180] = {SSD1306_SEGMENT_REMAP_0, SSD1306_SET_COM_OUTPUT_SCAN_DIRECTION_NORMAL},
+    [ssd1306_orientation_mirrored_horizontal] = {SSD1306_SEGMENT_REMAP_0, SSD1306_SET_COM_OUTPUT_SCAN_DIRECTION_REMAPPED},
+    [ssd1306_orientation_mirrored_vertical] = {SSD1306_SEGMENT_REMAP_127, SSD1306_SET_COM_OUTPUT_SCAN_DIRECTION_NORMAL}
+};
+
+/*
+ * Command that has been requested but not yet sent to the display
+ */
+struct ssd1306_queued_command_t
+{
+    uint8_t command[SSD1306_COMMAND_MAX_LEN];
+    uint8_t len;
+    enum ssd1306_result_t *result;
+};
+
+/*
+ * Last known configuration of the display controller, used to skip commands
+ * that would not change anything. A setting is only known if its bit is set in
+ * the valid field. The shadow is updated when a command is queued, i.e. it
+ * holds the configuration after all queued commands have been sent.
+ * The window position is the number of bytes written since the RAM pointer was
+ * at the start of the window, modulo the window size. In horizontal and
+ * vertical addressing mode the pointer wraps to the start of the window after
+ * the last byte. In page addressing mode, the page and column of the RAM
+ * pointer are kept instead.
+ */
+struct ssd1306_shadow_t
+{
+    uint16_t valid;
+    uint8_t contrast;
+    uint8_t displayOn;
+    uint8_t inverted;
+    uint8_t entireDisplayOn;
+    uint8_t scrollActive;
+    uint8_t orientation;
+    uint8_t fade;
+    uint8_t zoomIn;
+    uint8_t addressingMode;
+    uint8_t colStart;
+    uint8_t colEnd;
+    uint8_t pageStart;
+    uint8_t pageEnd;
+    uint16_t windowPosition;
+    uint8_t pointerPage;
+    uint8_t pointerColumn;
+};
+
+/*
+ * SSD1306 class. There is one instance for each display.
+ */
+struct ssd1306_t
+{
+    uint8_t address;
+    uint8_t width;
+    uint8_t height;
+    uint8_t columnOffset;
+    uint8_t initCommands[sizeof(initSequence)];
     enum ssd1306_state_t state;
     enum ssd1306_operation_step_t operationStep;
     enum ssd1306_result_t *operationResult;
@@ -107,642 +257,1970 @@ static struct ssd1306_t
     bool operationOngoing;
     uint8_t commandBuffer[SSD1306_COMMAND_BUFFER_SIZE];
     uint8_t commandLen;
-    uint8_t *graphicsData;
+    struct ssd1306_queued_command_t queue[SSD1306_COMMAND_QUEUE_SIZE];
+    uint8_t queueHead;
+    uint8_t queueCount;
+    uint8_t queueInFlight;
+    const struct ssd1306_data_span_t *spans;
+    uint8_t spanCount;
+    uint8_t spanIndex;
+    uint16_t spanOffset;
+    uint16_t dataBudget;
+#if !(SSD1306_GDDRAM_SHADOW)
+    uint16_t dataAcked;         // Bytes of the data request that have been sent
+#endif
+    uint8_t dataPage;
+    uint8_t pageBytesLeft;
+    struct ssd1306_data_span_t bufferSpan;
+    const uint8_t *graphicsData;
     uint16_t dataLen;
-    uint8_t delayTime;
+    uint32_t delayDeadline;     // Time (ms) when the power on delay ends
     enum ssd1306_addressing_mode_t addressingMode;
     uint8_t colStart;
     uint8_t colEnd;
     uint8_t pageStart;
     uint8_t pageEnd;
-    enum i2c_op_result_t commandResult;
-} self;
+    BUS_RESULT_T commandResult;
+    struct ssd1306_shadow_t shadow;
+#if (SSD1306_GDDRAM_SHADOW)
+    // Copy of the display RAM and a bit per byte that tells if it is known
+    uint8_t gddram[GDDRAM_SIZE];
+    uint8_t gddramKnown[GDDRAM_SIZE / 8];
+    uint8_t streamColumn;
+    uint8_t streamPage;
+    uint16_t runLeft;
+    // Position before the data transfer that is in flight
+    uint8_t resumeSpanIndex;
+    uint16_t resumeSpanOffset;
+    uint8_t resumeColumn;
+    uint8_t resumePage;
+#endif
+    uint8_t retries;
+    uint8_t backoff;
+    struct ssd1306_statistics_t statistics;
+#if (SSD1306_BUS != SSD1306_BUS_SPI)
+    uint8_t i2cClient;
+#endif
+};
+
+/*
+ * Displays handled by the driver. Requests are made to the display given to the
+ * request function, or to the selected display, and self points to the display
+ * that is operated on.
+ */
+static struct ssd1306_t displays[SSD1306_MAX_DISPLAYS];
+static uint8_t displayCount;
+static uint8_t selectedDisplay;
+static uint8_t firstDisplayToRun;
+static struct ssd1306_t *self;
 
 void ssd1306_init (uint8_t taskId)
 {
-    self.taskId = taskId;
-    self.operationResult = NULL;
-    self.state = ssd1306_idle_state;
-    self.operationStep = ssd1306_none_step;
-    self.commandType = no_command;
-    self.operationOngoing = false;
-    self.commandResult = i2c_operation_ok;
-    self.commandLen = 0;
-    self.graphicsData = NULL;
-    self.dataLen = 0;
-    self.delayTime = 0;
-    self.addressingMode = SSD1306_DEFAULT_MEMORY_ADDRESSING_MODE;
-    self.colStart = 0;
-    self.colEnd = 127;
-    self.pageStart = 0;
-    self.pageEnd = 7;
+    (void)taskId;
+#if (SSD1306_BUS != SSD1306_BUS_SPI)
+    // The displays of a previous init give up their place on the bus, and any
+    // request that is still waiting for it
+    for (uint8_t i=0; i<displayCount; i++)
+    {
+        i2c_arbiter_removeClient(displays[i].i2cClient);
+    }
+#endif
+    displayCount = 0;
+    selectedDisplay = 0;
+    firstDisplayToRun = 0;
+#if (SSD1306_BUS == SSD1306_BUS_SPI)
+    (void)ssd1306_addDisplay(SSD1306_SPI_DEVICE, SSD1306_WIDTH, SSD1306_HEIGHT, SSD1306_COLUMN_OFFSET);
+#else
+    (void)ssd1306_addDisplay(SSD1306_I2C_SLAVE_ADDRESS, SSD1306_WIDTH, SSD1306_HEIGHT, SSD1306_COLUMN_OFFSET);
+#endif
+    self = &displays[selectedDisplay];
+}
+
+uint8_t ssd1306_addDisplay(uint8_t address, uint8_t width, uint8_t height, uint8_t columnOffset)
+{
+    if ((displayCount >= SSD1306_MAX_DISPLAYS) || !validGeometry(width, height, columnOffset))
+    {
+        return SSD1306_NO_DISPLAY;
+    }
+    self = &displays[displayCount];
+    self->address = address;
+    self->width = width;
+    self->height = height;
+    self->columnOffset = columnOffset;
+    memcpy(self->initCommands, initSequence, sizeof(initSequence));
+    self->initCommands[INIT_SEQUENCE_MUX_INDEX] = height - 1;
+
+    self->operationResult = NULL;
+    self->state = ssd1306_idle_state;
+    self->operationStep = ssd1306_none_step;
+    self->commandType = no_command;
+    self->operationOngoing = false;
+    self->commandResult = BUS_OPERATION_OK;
+    self->commandLen = 0;
+    self->queueHead = 0;
+    self->queueCount = 0;
+    self->queueInFlight = 0;
+    self->spans = NULL;
+    self->spanCount = 0;
+    self->spanIndex = 0;
+    self->spanOffset = 0;
+    self->dataBudget = 0;
+#if !(SSD1306_GDDRAM_SHADOW)
+    self->dataAcked = 0;
+#endif
+    self->dataPage = 0;
+    self->pageBytesLeft = 0;
+    self->graphicsData = NULL;
+    self->dataLen = 0;
+    self->delayDeadline = 0;
+    self->addressingMode = SSD1306_DEFAULT_MEMORY_ADDRESSING_MODE;
+    self->colStart = 0;
+    self->colEnd = width - 1;
+    self->pageStart = 0;
+    self->pageEnd = height / 8u - 1;
+    self->shadow.valid = 0;
+#if (SSD1306_GDDRAM_SHADOW)
+    clearGddramShadow();
+    self->streamColumn = 0;
+    self->streamPage = 0;
+    self->runLeft = 0;
+#endif
+    self->retries = 0;
+    self->backoff = 0;
+    memset(&self->statistics, 0, sizeof(self->statistics));
+#if (SSD1306_BUS != SSD1306_BUS_SPI)
+    self->i2cClient = i2c_arbiter_addClient(I2C_ARBITER_PRIORITY_SSD1306);
+#endif
+    self = &displays[selectedDisplay];
+    return displayCount++;
+}
+
+bool ssd1306_selectDisplay(uint8_t display)
+{
+    if (display >= displayCount)
+    {
+        return false;
+    }
+    selectedDisplay = display;
+    self = &displays[selectedDisplay];
+    return true;
+}
+
+uint8_t ssd1306_getSelectedDisplay(void)
+{
+    return selectedDisplay;
+}
+
+bool ssd1306_getWakeupTime(uint32_t *time)
+{
+    bool waiting = false;
+
+    for (uint8_t i=0; i<displayCount; i++)
+    {
+        struct ssd1306_t *display = &displays[i];
+
+        if ((display->state == ssd1306_init_display_state) &&
+            (display->operationStep == ssd1306_init_delay_step))
+        {
+            if (!waiting || ((int32_t)(display->delayDeadline - *time) < 0))
+            {
+                *time = display->delayDeadline;
+            }
+            waiting = true;
+        }
+        else if ((display->state != ssd1306_idle_state) || (display->queueCount > 0))
+        {
+            return false;
+        }
+    }
+    return waiting;
+}
+
+void ssd1306_getStatistics(struct ssd1306_statistics_t *statistics)
+{
+    *statistics = displays[selectedDisplay].statistics;
+}
+
+/*
+ * Let self point to the display that a request is made to. Returns false if
+ * there is no such display.
+ */
+static bool useDisplay(uint8_t display)
+{
+    if (display >= displayCount)
+    {
+        return false;
+    }
+    self = &displays[display];
+    return true;
+}
+
+/*
+ * Returns true if the display waits for the power on delay to end. Nothing else
+ * is sent to the display before the init sequence.
+ */
+static bool waitingForDelay(void)
+{
+    return (self->state == ssd1306_init_display_state) &&
+           (self->operationStep == ssd1306_init_delay_step) &&
+           !deadlineReached(self->delayDeadline);
+}
+
+/*
+ * Compare with the time source. The difference handles that the time wraps.
+ */
+static bool deadlineReached(uint32_t deadline)
+{
+    return (int32_t)(timer_getMilliseconds() - deadline) >= 0;
+}
+
+/*
+ * Check that the panel fits in the display RAM. With the display RAM shadow, the
+ * shadow has room for SSD1306_WIDTH columns.
+ */
+static bool validGeometry(uint8_t width, uint8_t height, uint8_t columnOffset)
+{
+#if (SSD1306_GDDRAM_SHADOW)
+    if (width > SSD1306_WIDTH)
+    {
+        return false;
+    }
+#endif
+    return (width > 0) && (width + columnOffset <= SSD1306_GDDRAM_COLUMNS) &&
+           (height >= SSD1306_MUX_MIN_VALUE) && (height <= SSD1306_MUX_MAX_VALUE) && (height % 8u == 0);
 }
 
 void ssd1306_run (void)
 {
-    if (self.operationOngoing)
+    uint8_t display = firstDisplayToRun;
+
+    if (displayCount == 0)
+    {
+        return;
+    }
+
+    // Run the displays in turn. The display that runs first changes for each
+    // run, so that the displays get the bus in turn between their transfers.
+    for (uint8_t i=0; i<displayCount; i++)
+    {
+        self = &displays[display];
+        (void)runDisplay();
+        display = (display + 1) % displayCount;
+    }
+    firstDisplayToRun = (firstDisplayToRun + 1) % displayCount;
+    self = &displays[selectedDisplay];
+}
+
+/*
+ * Run the state machine of the display that self points to.
+ */
+static bool runDisplay(void)
+{
+    uint8_t steps = 0;
+
+    if (waitingForDelay())
+    {
+        return false;
+    }
+
+    // Number of graphics data bytes that may be sent during this run
+    self->dataBudget = SSD1306_DATA_CHUNK_SIZE;
+
+    // Run as many steps as possible until a step has to wait for the bus or
+    // the step budget has been used
+    while ((steps < SSD1306_RUN_STEP_BUDGET) && runStep())
+    {
+        steps++;
+    }
+    return steps > 0;
+}
+
+/*
+ * Run one step of the state machine. The function returns true if the step
+ * made progress and the next step can be run directly, and false if the driver
+ * is idle or has to wait for the bus.
+ */
+static bool runStep(void)
+{
+    if (self->operationOngoing)
     {
-        // Only I2C at the moment
-        if (self.commandResult == i2c_operation_processing)
+        if (self->commandResult == BUS_OPERATION_PROCESSING)
         {
             // Wait until the operation has finished
-            return;
+            return false;
         }
-        else
+        self->operationOngoing = false;
+        if (self->commandResult != BUS_OPERATION_OK)
         {
-            self.operationOngoing = false;
-            self.commandType = no_command;
+            return handleTransferError();
         }
-
-        if (self.commandResult != i2c_operation_ok)
+        self->retries = 0;
+        if (self->commandType == queued_commands)
+        {
+            completeQueuedCommands(ssd1306_result_ok);
+        }
+#if !(SSD1306_GDDRAM_SHADOW)
+        else if (self->commandType == send_data_command)
         {
-            // Handle error
+            self->dataAcked += self->dataLen;
         }
+#endif
+        self->commandType = no_command;
+    }
+    else if (self->backoff > 0)
+    {
+        // Wait before the failed transfer is sent again
+        self->backoff--;
+        return false;
     }
     // Check if there is a new command request to handle
-    else if (self.commandType == single_command)
+    else if (self->commandType == single_command)
     {
-        if (i2c_masterTransmit(SSD1306_I2C_SLAVE_ADDRESS, self.commandBuffer,
-                               self.commandLen, &self.commandResult) == i2c_request_ok)
-        {
-            self.operationOngoing = true;
-        }
-        return;
+        self->operationOngoing = busTransmit(SSD1306_COMMAND_SINGLE, self->commandBuffer, self->commandLen);
+        return self->operationOngoing;
     }
-    else if (self.commandType == send_data_command)
+    else if (self->commandType == init_sequence_command)
     {
-        if (i2c_masterTransmitRegister(SSD1306_I2C_SLAVE_ADDRESS, SSD1306_DATA_SINGLE, self.graphicsData,
-                                       self.dataLen, &self.commandResult) == i2c_request_ok)
-        {
-            self.operationOngoing = true;
-        }
-        return;
+        self->operationOngoing = busTransmit(SSD1306_COMMAND_SINGLE, self->initCommands, sizeof(self->initCommands));
+        return self->operationOngoing;
+    }
+    else if (self->commandType == send_data_command)
+    {
+        self->operationOngoing = busTransmit(SSD1306_DATA_SINGLE, self->graphicsData, self->dataLen);
+        return self->operationOngoing;
     }
 
-    switch (self.state)
+    // Queued commands are sent as soon as the bus is free (see
+    // queuedCommandsAllowed)
+    if ((self->queueCount > 0) && queuedCommandsAllowed())
+    {
+        return sendQueuedCommands();
+    }
+
+    switch (self->state)
     {
-        case ssd1306_idle_state:
-            break;
         case ssd1306_init_display_state:
-            initDisplay();
-            break;
-        case ssd1306_single_command_state:
-            // Not implemented
-            break;
+            return initDisplay();
         case ssd1306_send_graphics_data_state:
-            sendData();
-            break;
+            return sendData();
+        case ssd1306_idle_state:
+        default:
+            return false;
+    }
+}
+
+/*
+ * Returns true if the queued commands may be sent. During the display init they
+ * are held back until the init sequence has been sent. During a graphics data
+ * transfer they are held back until the last data has been sent, so that e.g. a
+ * segment remap or a new start line does not take effect in the middle of a
+ * frame. Commands that are queued before the transfer has started are sent
+ * first.
+ */
+static bool queuedCommandsAllowed(void)
+{
+    switch (self->state)
+    {
+        case ssd1306_idle_state:
+            return true;
+        case ssd1306_send_graphics_data_state:
+            return self->operationStep == ssd1306_data_set_window_step;
+        case ssd1306_init_display_state:
+        default:
+            return false;
     }
 }
 
-static void initDisplay(void)
+static bool initDisplay(void)
 {
-    switch(self.operationStep)
+    switch(self->operationStep)
     {
         case ssd1306_init_delay_step:
-            if (self.delayTime++ == INIT_DELAY_TIME)
+            if (!deadlineReached(self->delayDeadline))
             {
-                self.operationStep = ssd1306_init_set_mux_ratio_step;
+                // Wait for the display to power up
+                return false;
             }
+            self->operationStep = ssd1306_init_send_sequence_step;
             break;
-        case ssd1306_init_set_mux_ratio_step:
-            prepareSetMultiPlexRatioCommand(SSD1306_DEFAULT_MUX_VALUE);
-            self.operationStep = ssd1306_init_set_display_offset_step;
-            break;
-        case ssd1306_init_set_display_offset_step:
-            prepareSetDisplayOffset(SSD1306_DEFAULT_DISPLAY_OFFSET);
-            self.operationStep = ssd1306_init_set_display_start_line_step;
-            break;
-        case ssd1306_init_set_display_start_line_step:
-            prepareSetDisplayStartLine(SSD1306_DEFAULT_DISPLAY_STARTLINE);
-            self.operationStep = ssd1306_init_set_segment_remap_step;
-            break;
-        case ssd1306_init_set_segment_remap_step:
-            prepareSetSegmentRemap_127();
-            self.operationStep = ssd1306_init_set_com_output_scan_direction_step;
-            break;
-        case ssd1306_init_set_com_output_scan_direction_step:
-            prepareSetComOutputScanDirectionRemapped();
-            self.operationStep = ssd1306_init_set_com_pins_hardware_configuration_step;
-            break;
-        case ssd1306_init_set_com_pins_hardware_configuration_step:
-            prepareSetComPinsHardwareConfig(SSD1306_DEFAULT_COM_HW_PIN_USE_ALT_COM_PIN_CONF,
-                                            SSD1306_DEFAULT_COM_HW_PIN_EN_LEFT_RIGHT_REMAP);
-            self.operationStep = ssd1306_init_set_contrast_step;
-            break;
-        case ssd1306_init_set_contrast_step:
-            prepareSetContrast(SSD1306_DEFAULT_CONTRAST);
-            self.operationStep = ssd1306_init_set_use_pixels_from_ram_step;
-            break;
-        case ssd1306_init_set_use_pixels_from_ram_step:
-            prepareSetPixelsFromRAM();
-            self.operationStep = ssd1306_init_set_normal_display_step;
-            break;
-        case ssd1306_init_set_normal_display_step:
-            prepareSetNormalDisplay();
-            self.operationStep = ssd1306_init_set_clock_divider_and_oscillator_step;
-            break;
-        case ssd1306_init_set_clock_divider_and_oscillator_step:
-            prepareSetDisplayClock(SSD1306_DEFAULT_DISPLAY_CLOCK_DIVIDE_RATIO, SSD1306_DEFAULT_OSCILLATOR_FREQUENCY);
-            self.operationStep = ssd1306_init_charge_pump_setting_step;
-            break;
-        case ssd1306_init_charge_pump_setting_step:
-            prepareEnableChargePump();
-            self.operationStep = ssd1306_init_set_addressing_mode_step;
-            break;
-        case ssd1306_init_set_addressing_mode_step:
-            prepareSetAddressingMode(self.addressingMode);
-            self.operationStep = ssd1306_init_display_on_step;
-            break;
-        case ssd1306_init_display_on_step:
-            prepareSetDisplayOn();
-            self.operationStep = ssd1306_init_done;
+        case ssd1306_init_send_sequence_step:
+            self->commandType = init_sequence_command;
+            self->operationStep = ssd1306_init_done;
             break;
         case ssd1306_init_done:
-            self.state = ssd1306_idle_state;
-            *self.operationResult = ssd1306_result_ok;
+            self->state = ssd1306_idle_state;
+            *self->operationResult = ssd1306_result_ok;
             break;
         case ssd1306_none_step:
             // Nothing to do
+            return false;
+        default:
+            // Should not happen. Handle error?
+            return false;
+    }
+    return true;
+}
+
+static bool sendData(void)
+{
+    switch(self->operationStep)
+    {
+        case ssd1306_data_set_window_step:
+            prepareSetWindow();
+            self->operationStep = ssd1306_data_send_graphics_data_step;
+            break;
+        case ssd1306_data_resume_step:
+#if !(SSD1306_GDDRAM_SHADOW)
+            prepareResume();
+#endif
+            self->operationStep = ssd1306_data_send_graphics_data_step;
+            break;
+        case ssd1306_data_send_graphics_data_step:
+#if (SSD1306_GDDRAM_SHADOW)
+            return prepareNextChangedRun();
+#else
+            return prepareNextChunk();
+#endif
+        case ssd1306_data_send_done:
+            self->state = ssd1306_idle_state;
+            *self->operationResult = ssd1306_result_ok;
             break;
         default:
             // Should not happen. Handle error?
+            return false;
+    }
+    return true;
+}
+
+#if !(SSD1306_GDDRAM_SHADOW)
+/*
+ * Prepare the transfer of the next chunk of graphics data. The spans are sent
+ * directly from the caller's memory, in chunks that fit in the data budget of
+ * the run. The display continues to write at the next position in the window
+ * for each transfer. Returns false if the run has to end before the next chunk.
+ */
+static bool prepareNextChunk(void)
+{
+    skipEmptySpans();
+    if (self->spanIndex >= self->spanCount)
+    {
+        self->operationStep = ssd1306_data_send_done;
+        return true;
+    }
+    if (self->dataBudget == 0)
+    {
+        // Let other users of the bus get a time slot before the next chunk is
+        // sent
+        return false;
+    }
+    if ((self->addressingMode == SSD1306_PAGE_ADDRESSING_MODE) && (self->pageBytesLeft == 0))
+    {
+        // Move the RAM pointer to the start of the next page
+        self->commandLen = 0;
+        appendPageHeader(self->dataPage, self->colStart);
+        self->pageBytesLeft = windowWidth();
+        self->dataPage = (self->dataPage < self->pageEnd) ? self->dataPage + 1 : self->pageStart;
+        return true;
+    }
+    self->graphicsData = self->spans[self->spanIndex].data + self->spanOffset;
+    self->dataLen = self->spans[self->spanIndex].len - self->spanOffset;
+    if (self->dataLen > self->dataBudget)
+    {
+        self->dataLen = self->dataBudget;
+    }
+    if (self->addressingMode == SSD1306_PAGE_ADDRESSING_MODE)
+    {
+        // Each transfer ends at the end of the page in the window
+        if (self->dataLen > self->pageBytesLeft)
+        {
+            self->dataLen = self->pageBytesLeft;
+        }
+        self->pageBytesLeft -= self->dataLen;
+    }
+    self->dataBudget -= self->dataLen;
+    advanceRamPointer(self->dataLen);
+    advanceSpans(self->dataLen);
+    self->commandType = send_data_command;
+    return true;
+}
+#endif
+
+#if !(SSD1306_GDDRAM_SHADOW)
+/*
+ * Move the RAM pointer to the position of the last acknowledged data. In page
+ * addressing mode the pointer is moved to the exact position. In horizontal and
+ * vertical addressing mode the window is set to start at the beginning of the
+ * row (page or column) with the position, and the data is sent from there.
+ */
+static void prepareResume(void)
+{
+    uint8_t width = windowWidth();
+    uint8_t pages = self->pageEnd - self->pageStart + 1;
+    uint16_t position = self->dataAcked % (uint16_t)(width * pages);
+    uint16_t rowLength = (self->addressingMode == SSD1306_VERTICAL_ADDRESSING_MODE) ? pages : width;
+    uint8_t row = position / rowLength;
+
+    self->commandLen = 0;
+    appendAddressingMode();
+    if (self->addressingMode == SSD1306_PAGE_ADDRESSING_MODE)
+    {
+        seekSpans(self->dataAcked);
+        appendPageHeader(self->pageStart + row, self->colStart + position % width);
+        self->pageBytesLeft = width - position % width;
+        self->dataPage = (self->pageStart + row < self->pageEnd) ? self->pageStart + row + 1 : self->pageStart;
+    }
+    else
+    {
+        // The data from the start of the row is sent again
+        self->dataAcked -= position % rowLength;
+        seekSpans(self->dataAcked);
+        if (self->addressingMode == SSD1306_VERTICAL_ADDRESSING_MODE)
+        {
+            appendWindow(self->colStart + row, self->colEnd, self->pageStart, self->pageEnd);
+        }
+        else
+        {
+            appendWindow(self->colStart, self->colEnd, self->pageStart + row, self->pageEnd);
+        }
+    }
+}
+#endif
+
+static void skipEmptySpans(void)
+{
+    while ((self->spanIndex < self->spanCount) && (self->spans[self->spanIndex].len == 0))
+    {
+        self->spanIndex++;
+    }
+}
+
+/*
+ * Move the position in the spans. The length must not exceed the rest of the
+ * current span.
+ */
+static void advanceSpans(uint16_t length)
+{
+    self->spanOffset += length;
+    if (self->spanOffset >= self->spans[self->spanIndex].len)
+    {
+        self->spanIndex++;
+        self->spanOffset = 0;
+    }
+}
+
+#if !(SSD1306_GDDRAM_SHADOW)
+/*
+ * Move the position in the spans to the given offset from the start of the
+ * first span.
+ */
+static void seekSpans(uint16_t offset)
+{
+    self->spanIndex = 0;
+    self->spanOffset = 0;
+    skipEmptySpans();
+    while ((self->spanIndex < self->spanCount) && (offset > 0))
+    {
+        uint16_t length = self->spans[self->spanIndex].len - self->spanOffset;
+        if (length > offset)
+        {
+            length = offset;
+        }
+        advanceSpans(length);
+        offset -= length;
+        skipEmptySpans();
+    }
+}
+#endif
+
+#if (SSD1306_GDDRAM_SHADOW)
+/*
+ * Prepare the next transfer when the display RAM is shadowed. Data that the
+ * display already holds is skipped. Each run of changed data gets its own
+ * window (or page header in page addressing mode) and is then sent in chunks
+ * that fit in the data budget of the run. Unchanged gaps that are cheaper to
+ * send than to skip are included in the run. A run never continues past the
+ * end of a row of the window (a page, or a column in vertical addressing mode).
+ */
+static bool prepareNextChangedRun(void)
+{
+    uint8_t runColEnd;
+    uint8_t runPageEnd;
+
+    skipEmptySpans();
+    while ((self->runLeft == 0) && (self->spanIndex < self->spanCount) &&
+           !gddramDiffers(streamIndex(0), self->spans[self->spanIndex].data[self->spanOffset]))
+    {
+        advanceStream(1);
+        skipEmptySpans();
+    }
+    if (self->spanIndex >= self->spanCount)
+    {
+        self->operationStep = ssd1306_data_send_done;
+        return true;
+    }
+    if (self->dataBudget == 0)
+    {
+        // Let other users of the bus get a time slot before the next chunk is
+        // sent
+        return false;
+    }
+
+    if (self->runLeft == 0)
+    {
+        // Move the RAM pointer to the start of the next changed run
+        self->runLeft = findChangedRun();
+        self->commandLen = 0;
+        appendAddressingMode();
+        if (self->addressingMode == SSD1306_PAGE_ADDRESSING_MODE)
+        {
+            appendPageHeader(self->streamPage, self->streamColumn);
+        }
+        else
+        {
+            runColEnd = self->streamColumn;
+            runPageEnd = self->streamPage;
+            if (self->addressingMode == SSD1306_VERTICAL_ADDRESSING_MODE)
+            {
+                runPageEnd += self->runLeft - 1;
+            }
+            else
+            {
+                runColEnd += self->runLeft - 1;
+            }
+            appendWindow(self->streamColumn, runColEnd, self->streamPage, runPageEnd);
+        }
+        return true;
+    }
+
+    self->resumeSpanIndex = self->spanIndex;
+    self->resumeSpanOffset = self->spanOffset;
+    self->resumeColumn = self->streamColumn;
+    self->resumePage = self->streamPage;
+    self->graphicsData = self->spans[self->spanIndex].data + self->spanOffset;
+    self->dataLen = self->spans[self->spanIndex].len - self->spanOffset;
+    if (self->dataLen > self->runLeft)
+    {
+        self->dataLen = self->runLeft;
+    }
+    if (self->dataLen > self->dataBudget)
+    {
+        self->dataLen = self->dataBudget;
+    }
+    for (uint16_t i=0; i<self->dataLen; i++)
+    {
+        uint16_t index = streamIndex(i);
+        self->gddram[index] = self->graphicsData[i];
+        self->gddramKnown[index / 8] |= (uint8_t)(1u << (index % 8));
+    }
+    self->dataBudget -= self->dataLen;
+    self->runLeft -= self->dataLen;
+    advanceRamPointer(self->dataLen);
+    advanceStream(self->dataLen);
+    self->commandType = send_data_command;
+    return true;
+}
+
+/*
+ * Find the length of the run of changed data that starts at the current
+ * position. The data at the current position must differ from the display RAM.
+ */
+static uint16_t findChangedRun(void)
+{
+    uint8_t index = self->spanIndex;
+    uint16_t offset = self->spanOffset;
+    uint16_t rowLeft = streamRowLeft();
+    uint16_t runLen = 0;
+    uint16_t gap = 0;
+    uint16_t rewindowCost = (self->addressingMode == SSD1306_PAGE_ADDRESSING_MODE) ?
+                            GDDRAM_REWINDOW_COST_PAGE_MODE : GDDRAM_REWINDOW_COST_WINDOW;
+
+    for (uint16_t i=0; (i < rowLeft) && (index < self->spanCount); i++)
+    {
+        if (gddramDiffers(streamIndex(i), self->spans[index].data[offset]))
+        {
+            runLen = i + 1;
+            gap = 0;
+        }
+        else if (++gap >= rewindowCost)
+        {
             break;
+        }
+        if (++offset >= self->spans[index].len)
+        {
+            offset = 0;
+            do
+            {
+                index++;
+            } while ((index < self->spanCount) && (self->spans[index].len == 0));
+        }
+    }
+    return runLen;
+}
+
+/*
+ * Index in the display RAM of the data at the offset from the current position
+ * along the row of the window.
+ */
+static uint16_t streamIndex(uint16_t offset)
+{
+    if (self->addressingMode == SSD1306_VERTICAL_ADDRESSING_MODE)
+    {
+        return (self->streamPage + offset) * SSD1306_WIDTH + self->streamColumn;
+    }
+    return self->streamPage * SSD1306_WIDTH + self->streamColumn + offset;
+}
+
+/*
+ * Number of bytes left on the current row of the window.
+ */
+static uint16_t streamRowLeft(void)
+{
+    if (self->addressingMode == SSD1306_VERTICAL_ADDRESSING_MODE)
+    {
+        return self->pageEnd - self->streamPage + 1;
+    }
+    return self->colEnd - self->streamColumn + 1;
+}
+
+/*
+ * Move the current position in the spans and in the window. The length must not
+ * exceed the rest of the current span or of the current row of the window.
+ */
+static void advanceStream(uint16_t length)
+{
+    advanceSpans(length);
+    if (self->addressingMode == SSD1306_VERTICAL_ADDRESSING_MODE)
+    {
+        self->streamPage += length;
+        if (self->streamPage > self->pageEnd)
+        {
+            self->streamPage = self->pageStart;
+            self->streamColumn = (self->streamColumn < self->colEnd) ? self->streamColumn + 1 : self->colStart;
+        }
+    }
+    else
+    {
+        self->streamColumn += length;
+        if (self->streamColumn > self->colEnd)
+        {
+            self->streamColumn = self->colStart;
+            self->streamPage = (self->streamPage < self->pageEnd) ? self->streamPage + 1 : self->pageStart;
+        }
+    }
+}
+
+static bool gddramDiffers(uint16_t index, uint8_t value)
+{
+    return !(self->gddramKnown[index / 8] & (1u << (index % 8))) || (self->gddram[index] != value);
+}
+
+static void clearGddramShadow(void)
+{
+    memset(self->gddramKnown, 0, sizeof(self->gddramKnown));
+}
+#endif
+
+/*
+ * Start a transfer of commands or graphics data on the bus. The control byte is
+ * SSD1306_COMMAND_SINGLE for commands and SSD1306_DATA_SINGLE for graphics data.
+ * On I2C it is sent before the buffer; 0x00 (Co=0, D/C=0) means that all following
+ * bytes are commands and 0x40 (Co=0, D/C=1) that they are data. On SPI the D/C
+ * line is used instead. The line is only changed when no transfer to a display
+ * is in progress, since the display samples it during the transfer. On I2C the
+ * transfer is submitted to the bus arbiter. Returns true if the transfer was
+ * started.
+ */
+static bool busTransmit(uint8_t control, const uint8_t *buffer, uint16_t length)
+{
+#if (SSD1306_BUS == SSD1306_BUS_SPI)
+    if (spiTransferOngoing())
+    {
+        return false;
+    }
+    ssd1306_setDataCommandLine(control == SSD1306_DATA_SINGLE);
+    return spi_masterTransmit(self->address, buffer, length,
+                              &self->commandResult) == spi_request_ok;
+#else
+    return i2c_arbiter_transmitRegister(self->i2cClient, self->address, control,
+                                        buffer, length, &self->commandResult) == i2c_request_ok;
+#endif
+}
+
+#if (SSD1306_BUS == SSD1306_BUS_SPI)
+/*
+ * Returns true if a transfer to any of the displays is still on the SPI bus.
+ */
+static bool spiTransferOngoing(void)
+{
+    for (uint8_t i=0; i<displayCount; i++)
+    {
+        if (displays[i].operationOngoing && (displays[i].commandResult == BUS_OPERATION_PROCESSING))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+#endif
+
+/*
+ * Handle a transfer that has failed. The transfer is sent again after a backoff
+ * that doubles for each retry, until SSD1306_RETRY_LIMIT retries have failed and
+ * the operation fails with ssd1306_result_error.
+ *
+ * If the transfer never reached the display (start or address error), the
+ * controller is unchanged and the same transfer is sent again. Otherwise, the
+ * position of the RAM pointer is no longer known; commands are sent again in
+ * full, and a graphics data transfer is resumed at the last acknowledged data.
+ */
+static bool handleTransferError(void)
+{
+    bool notStarted = transferNotStarted();
+
+    if (notStarted)
+    {
+        self->statistics.notStartedErrors++;
+    }
+    else
+    {
+        self->statistics.interruptedErrors++;
+        self->shadow.valid &= ~(SHADOW_WINDOW | SHADOW_PAGE_POINTER);
+    }
+
+    if (self->retries >= SSD1306_RETRY_LIMIT)
+    {
+        failOperation();
+        return false;
+    }
+    self->retries++;
+    self->backoff = (uint8_t)(SSD1306_RETRY_BACKOFF << (self->retries - 1));
+
+    if (self->commandType == queued_commands)
+    {
+        // The commands are still first in the queue
+        self->queueInFlight = 0;
+        self->commandType = no_command;
+        self->statistics.retries++;
+    }
+    else if ((self->state == ssd1306_send_graphics_data_state) && !notStarted)
+    {
+        resumeData();
+        self->commandType = no_command;
+        self->statistics.resumes++;
+    }
+    else
+    {
+        // The command type is kept and the transfer is sent again as it is
+        self->statistics.retries++;
+    }
+    return false;
+}
+
+/*
+ * Returns true if the failed transfer did not reach the display.
+ */
+static bool transferNotStarted(void)
+{
+#if (SSD1306_BUS == SSD1306_BUS_SPI)
+    return false;
+#else
+    return (self->commandResult == i2c_operation_start_error) ||
+           (self->commandResult == i2c_operation_repeated_start_error) ||
+           (self->commandResult == i2c_operation_sla_error);
+#endif
+}
+
+/*
+ * Continue the graphics data transfer from the last acknowledged data after a
+ * failed transfer. With the display RAM shadow, the failed data is marked as
+ * unknown and the changed data is sent again from there.
+ */
+static void resumeData(void)
+{
+#if (SSD1306_GDDRAM_SHADOW)
+    if (self->commandType == send_data_command)
+    {
+        self->spanIndex = self->resumeSpanIndex;
+        self->spanOffset = self->resumeSpanOffset;
+        self->streamColumn = self->resumeColumn;
+        self->streamPage = self->resumePage;
+        for (uint16_t i=0; i<self->dataLen; i++)
+        {
+            uint16_t index = streamIndex(i);
+            self->gddramKnown[index / 8] &= (uint8_t)~(1u << (index % 8));
+        }
+    }
+    self->runLeft = 0;
+    self->operationStep = ssd1306_data_send_graphics_data_step;
+#else
+    self->operationStep = ssd1306_data_resume_step;
+#endif
+}
+
+/*
+ * Give up the failed transfer. The requester gets ssd1306_result_error and the
+ * configuration of the controller is no longer known.
+ */
+static void failOperation(void)
+{
+    self->statistics.failures++;
+    self->retries = 0;
+    if (self->commandType == queued_commands)
+    {
+        completeQueuedCommands(ssd1306_result_error);
+    }
+    else if (self->state != ssd1306_idle_state)
+    {
+        self->state = ssd1306_idle_state;
+        self->operationStep = ssd1306_none_step;
+        *self->operationResult = ssd1306_result_error;
+    }
+    self->commandType = no_command;
+    self->shadow.valid = 0;
+#if (SSD1306_GDDRAM_SHADOW)
+    clearGddramShadow();
+#endif
+}
+
+/*
+ * Help functions to prepare commands
+ */
+static void appendCommand(const uint8_t *command, uint8_t length)
+{
+    self->commandType = single_command;
+    for (uint8_t i=0; i<length; i++)
+    {
+        self->commandBuffer[self->commandLen++] = command[i];
+    }
+}
+
+static enum ssd1306_request_t queueCommand(const uint8_t *command, uint8_t length,
+                                           enum ssd1306_result_t *result)
+{
+    struct ssd1306_queued_command_t *entry;
+
+    if (self->queueCount == SSD1306_COMMAND_QUEUE_SIZE)
+    {
+        return ssd1306_request_busy;
+    }
+
+    entry = &self->queue[(self->queueHead + self->queueCount) % SSD1306_COMMAND_QUEUE_SIZE];
+    for (uint8_t i=0; i<length; i++)
+    {
+        entry->command[i] = command[i];
+    }
+    entry->len = length;
+    entry->result = result;
+    *entry->result = ssd1306_result_processing;
+    self->queueCount++;
+    return ssd1306_request_ok;
+}
+
+/*
+ * Send as many of the queued commands as fit in the command buffer in one
+ * transaction.
+ */
+static bool sendQueuedCommands(void)
+{
+    struct ssd1306_queued_command_t *entry;
+    uint8_t index = self->queueHead;
+    uint8_t count = 0;
+
+    self->commandLen = 0;
+    while (count < self->queueCount)
+    {
+        entry = &self->queue[index];
+        if (self->commandLen + entry->len > SSD1306_COMMAND_BUFFER_SIZE)
+        {
+            break;
+        }
+        for (uint8_t i=0; i<entry->len; i++)
+        {
+            self->commandBuffer[self->commandLen++] = entry->command[i];
+        }
+        index = (index + 1) % SSD1306_COMMAND_QUEUE_SIZE;
+        count++;
+    }
+
+    if (busTransmit(SSD1306_COMMAND_SINGLE, self->commandBuffer, self->commandLen))
+    {
+        self->operationOngoing = true;
+        self->commandType = queued_commands;
+        self->queueInFlight = count;
+    }
+    return self->operationOngoing;
+}
+
+/*
+ * Queue a command that changes a setting in the shadow. If the setting is known
+ * to have the value already, the command is not sent and the request is done
+ * directly.
+ */
+static enum ssd1306_request_t queueSetting(uint16_t setting, uint8_t *shadowValue, uint8_t value,
+                                           const uint8_t *command, uint8_t length,
+                                           enum ssd1306_result_t *result)
+{
+    enum ssd1306_request_t request;
+
+    if ((self->shadow.valid & setting) && (*shadowValue == value))
+    {
+        *result = ssd1306_result_ok;
+        return ssd1306_request_ok;
+    }
+    request = queueCommand(command, length, result);
+    if (request == ssd1306_request_ok)
+    {
+        *shadowValue = value;
+        self->shadow.valid |= setting;
+    }
+    return request;
+}
+
+static void completeQueuedCommands(enum ssd1306_result_t result)
+{
+    while (self->queueInFlight > 0)
+    {
+        *self->queue[self->queueHead].result = result;
+        self->queueHead = (self->queueHead + 1) % SSD1306_COMMAND_QUEUE_SIZE;
+        self->queueCount--;
+        self->queueInFlight--;
+    }
+}
+
+/*
+ * Fundamental commands
+ */
+enum ssd1306_request_t ssd1306_initDisplayOn(uint8_t display, enum ssd1306_result_t *result)
+{
+    if (!useDisplay(display))
+    {
+        return ssd1306_request_invalid;
+    }
+    if (self->state == ssd1306_idle_state)
+    {
+        self->state = ssd1306_init_display_state;
+        self->operationStep = ssd1306_init_delay_step;
+        self->delayDeadline = timer_getMilliseconds() + SSD1306_POWER_ON_DELAY_MS;
+        self->operationResult = result;
+        *self->operationResult = ssd1306_result_processing;
+        setInitShadow();
+#if (SSD1306_GDDRAM_SHADOW)
+        // The display is usually initialized again after a reset, which leaves
+        // the display RAM undefined
+        clearGddramShadow();
+#endif
+        return ssd1306_request_ok;
+    }
+    return ssd1306_request_busy;
+}
+
+enum ssd1306_request_t ssd1306_initDisplay(enum ssd1306_result_t *result)
+{
+    return ssd1306_initDisplayOn(selectedDisplay, result);
+}
+
+/*
+ * Set the shadow to the values of the init sequence. Commands that are already
+ * queued are sent after the init sequence, so the shadow is only known if the
+ * queue is empty.
+ */
+static void setInitShadow(void)
+{
+    self->shadow.valid = 0;
+    if (self->queueCount == 0)
+    {
+        self->shadow.contrast = SSD1306_DEFAULT_CONTRAST;
+        self->shadow.displayOn = true;
+        self->shadow.inverted = false;
+        self->shadow.entireDisplayOn = false;
+        self->shadow.orientation = ssd1306_orientation_normal;
+        self->shadow.addressingMode = SSD1306_DEFAULT_MEMORY_ADDRESSING_MODE;
+        self->shadow.valid = SHADOW_CONTRAST | SHADOW_DISPLAY_ON | SHADOW_INVERTED |
+                            SHADOW_ENTIRE_DISPLAY_ON | SHADOW_ORIENTATION | SHADOW_ADDRESSING_MODE;
+    }
+}
+
+enum ssd1306_request_t ssd1306_setContrastOn(uint8_t display, uint8_t level, enum ssd1306_result_t *result)
+{
+    const uint8_t command[] = {SSD1306_SET_CONTRAST, level};
+
+    if (!useDisplay(display))
+    {
+        return ssd1306_request_invalid;
+    }
+    return queueSetting(SHADOW_CONTRAST, &self->shadow.contrast, level,
+                        command, sizeof(command), result);
+}
+
+enum ssd1306_request_t ssd1306_setContrast(uint8_t level, enum ssd1306_result_t *result)
+{
+    return ssd1306_setContrastOn(selectedDisplay, level, result);
+}
+
+enum ssd1306_request_t ssd1306_setPixelsFromRAMOn(uint8_t display, enum ssd1306_result_t *result)
+{
+    const uint8_t command[] = {SSD1306_SET_USE_PIXELS_FROM_RAM};
+
+    if (!useDisplay(display))
+    {
+        return ssd1306_request_invalid;
+    }
+    return queueSetting(SHADOW_ENTIRE_DISPLAY_ON, &self->shadow.entireDisplayOn, false,
+                        command, sizeof(command), result);
+}
+
+enum ssd1306_request_t ssd1306_setPixelsFromRAM(enum ssd1306_result_t *result)
+{
+    return ssd1306_setPixelsFromRAMOn(selectedDisplay, result);
+}
+
+enum ssd1306_request_t ssd1306_setAllPixelsActiveOn(uint8_t display, enum ssd1306_result_t *result)
+{
+    const uint8_t command[] = {SSD1306_SET_PIXELS_ENTIRE_DISPLAY_ON};
+
+    if (!useDisplay(display))
+    {
+        return ssd1306_request_invalid;
+    }
+    return queueSetting(SHADOW_ENTIRE_DISPLAY_ON, &self->shadow.entireDisplayOn, true,
+                        command, sizeof(command), result);
+}
+
+enum ssd1306_request_t ssd1306_setAllPixelsActive(enum ssd1306_result_t *result)
+{
+    return ssd1306_setAllPixelsActiveOn(selectedDisplay, result);
+}
+
+enum ssd1306_request_t ssd1306_setNormalDisplayOn(uint8_t display, enum ssd1306_result_t *result)
+{
+    const uint8_t command[] = {SSD1306_SET_NORMAL_DISPLAY};
+
+    if (!useDisplay(display))
+    {
+        return ssd1306_request_invalid;
+    }
+    return queueSetting(SHADOW_INVERTED, &self->shadow.inverted, false,
+                        command, sizeof(command), result);
+}
+
+enum ssd1306_request_t ssd1306_setNormalDisplay(enum ssd1306_result_t *result)
+{
+    return ssd1306_setNormalDisplayOn(selectedDisplay, result);
+}
+
+enum ssd1306_request_t ssd1306_setInvertedDisplayOn(uint8_t display, enum ssd1306_result_t *result)
+{
+    const uint8_t command[] = {SSD1306_SET_INVERTED_DISPLAY};
+
+    if (!useDisplay(display))
+    {
+        return ssd1306_request_invalid;
     }
+    return queueSetting(SHADOW_INVERTED, &self->shadow.inverted, true,
+                        command, sizeof(command), result);
+}
+
+enum ssd1306_request_t ssd1306_setInvertedDisplay(enum ssd1306_result_t *result)
+{
+    return ssd1306_setInvertedDisplayOn(selectedDisplay, result);
 }
 
-static void sendData(void)
+enum ssd1306_request_t ssd1306_setDisplayOnOn(uint8_t display, enum ssd1306_result_t *result)
 {
-    switch(self.operationStep)
+    const uint8_t command[] = {SSD1306_DISPLAY_ON};
+
+    if (!useDisplay(display))
     {
-        case ssd1306_data_set_col_position_step:
-            prepareSetColumnAddress();
-            self.operationStep = ssd1306_data_set_page_position_step;
-            break;
-        case ssd1306_data_set_page_position_step:
-            prepareSetPageAddress();
-            self.operationStep = ssd1306_data_send_graphics_data_step;
-            break;
-        case ssd1306_data_send_graphics_data_step:
-            self.commandType = send_data_command;
-            self.operationStep = ssd1306_data_send_done;
-            break;
-        case ssd1306_data_send_done:
-            self.state = ssd1306_idle_state;
-            *self.operationResult = ssd1306_result_ok;
-            break;
-        default:
-            // Should not happen. Handle error?
-            break;
+        return ssd1306_request_invalid;
     }
+    return queueSetting(SHADOW_DISPLAY_ON, &self->shadow.displayOn, true,
+                        command, sizeof(command), result);
 }
 
-/*
- * Help functions to prepare commands
- */
-static void createSingleCommand(uint8_t command, uint8_t length)
+enum ssd1306_request_t ssd1306_setDisplayOn(enum ssd1306_result_t *result)
 {
-    self.commandType = single_command;
-    self.commandBuffer[0] = SSD1306_COMMAND_SINGLE;
-    self.commandBuffer[1] = command;
-    self.commandLen = length;
+    return ssd1306_setDisplayOnOn(selectedDisplay, result);
 }
 
-static enum ssd1306_request_t createSingleCommandRequest(enum ssd1306_result_t *result)
+enum ssd1306_request_t ssd1306_setDisplaySleepOn(uint8_t display, enum ssd1306_result_t *result)
 {
-    self.state = ssd1306_single_command_state;
-    self.operationResult = result;
+    const uint8_t command[] = {SSD1306_DISPLAY_SLEEP};
 
-    // Check errors and return corresponding error code
-    return ssd1306_request_ok;
+    if (!useDisplay(display))
+    {
+        return ssd1306_request_invalid;
+    }
+    return queueSetting(SHADOW_DISPLAY_ON, &self->shadow.displayOn, false,
+                        command, sizeof(command), result);
+}
+
+enum ssd1306_request_t ssd1306_setDisplaySleep(enum ssd1306_result_t *result)
+{
+    return ssd1306_setDisplaySleepOn(selectedDisplay, result);
 }
 
 /*
- * Fundamental commands
+ * Scrolling commands
  */
-enum ssd1306_request_t ssd1306_initDisplay(enum ssd1306_result_t *result)
+enum ssd1306_request_t ssd1306_setupHorizontalScrollOn(uint8_t display, enum ssd1306_scroll_direction_t direction,
+                                                       uint8_t startPage, uint8_t endPage,
+                                                       enum ssd1306_scroll_interval_t interval,
+                                                       enum ssd1306_result_t *result)
 {
-    if (self.state == ssd1306_idle_state)
+    const uint8_t command[] = {(direction == ssd1306_scroll_left) ?
+                               SSD1306_LEFT_HORIZONTAL_SCROLL : SSD1306_RIGHT_HORIZONTAL_SCROLL,
+                               SSD1306_SCROLL_DUMMY_BYTE_00, startPage, interval, endPage,
+                               SSD1306_SCROLL_DUMMY_BYTE_00, SSD1306_SCROLL_DUMMY_BYTE_FF};
+
+    if (!useDisplay(display))
     {
-        self.state = ssd1306_init_display_state;
-        self.operationStep = ssd1306_init_delay_step;
-        self.operationResult = result;
-        *self.operationResult = ssd1306_result_processing;
-        return ssd1306_request_ok;
+        return ssd1306_request_invalid;
     }
-    return ssd1306_request_busy;
+    if ((endPage > SSD1306_SCROLL_PAGE_MAX) || (startPage > endPage) ||
+        (interval > ssd1306_scroll_2_frames))
+    {
+        return ssd1306_request_invalid;
+    }
+    return queueCommand(command, sizeof(command), result);
 }
 
-enum ssd1306_request_t ssd1306_setContrast(uint8_t level, enum ssd1306_result_t *result)
+enum ssd1306_request_t ssd1306_setupHorizontalScroll(enum ssd1306_scroll_direction_t direction,
+                                                     uint8_t startPage, uint8_t endPage,
+                                                     enum ssd1306_scroll_interval_t interval,
+                                                     enum ssd1306_result_t *result)
+{
+    return ssd1306_setupHorizontalScrollOn(selectedDisplay, direction, startPage, endPage, interval, result);
+}
+
+enum ssd1306_request_t ssd1306_setupVerticalAndHorizontalScrollOn(uint8_t display, enum ssd1306_scroll_direction_t direction,
+                                                                  uint8_t startPage, uint8_t endPage,
+                                                                  enum ssd1306_scroll_interval_t interval,
+                                                                  uint8_t verticalOffset,
+                                                                  enum ssd1306_result_t *result)
 {
-    if (self.state != ssd1306_idle_state)
+    const uint8_t command[] = {(direction == ssd1306_scroll_left) ?
+                               SSD1306_VERTICAL_AND_LEFT_HORIZONTAL_SCROLL :
+                               SSD1306_VERTICAL_AND_RIGHT_HORIZONTAL_SCROLL,
+                               SSD1306_SCROLL_DUMMY_BYTE_00, startPage, interval, endPage,
+                               verticalOffset};
+
+    if (!useDisplay(display))
     {
-        return ssd1306_request_busy;
+        return ssd1306_request_invalid;
     }
-    prepareSetContrast(level);
-    return createSingleCommandRequest(result);
+    if ((endPage > SSD1306_SCROLL_PAGE_MAX) || (startPage > endPage) ||
+        (interval > ssd1306_scroll_2_frames) || (verticalOffset > SSD1306_VERTICAL_SCROLL_OFFSET_MAX))
+    {
+        return ssd1306_request_invalid;
+    }
+    return queueCommand(command, sizeof(command), result);
 }
 
-static void prepareSetContrast(uint8_t level)
+enum ssd1306_request_t ssd1306_setupVerticalAndHorizontalScroll(enum ssd1306_scroll_direction_t direction,
+                                                                uint8_t startPage, uint8_t endPage,
+                                                                enum ssd1306_scroll_interval_t interval,
+                                                                uint8_t verticalOffset,
+                                                                enum ssd1306_result_t *result)
 {
-    createSingleCommand(SSD1306_SET_CONTRAST, 3);
-    self.commandBuffer[2] = level;
+    return ssd1306_setupVerticalAndHorizontalScrollOn(selectedDisplay, direction, startPage, endPage, interval, verticalOffset, result);
 }
 
-enum ssd1306_request_t ssd1306_setPixelsFromRAM(enum ssd1306_result_t *result)
+enum ssd1306_request_t ssd1306_setVerticalScrollAreaOn(uint8_t display, uint8_t fixedRows, uint8_t scrollRows,
+                                                       enum ssd1306_result_t *result)
 {
-    if (self.state != ssd1306_idle_state)
+    const uint8_t command[] = {SSD1306_SET_VERTICAL_SCROLL_AREA, fixedRows, scrollRows};
+
+    if (!useDisplay(display))
     {
-        return ssd1306_request_busy;
+        return ssd1306_request_invalid;
+    }
+    if ((fixedRows > SSD1306_VERTICAL_SCROLL_AREA_MAX_ROWS) ||
+        (scrollRows > SSD1306_VERTICAL_SCROLL_AREA_MAX_ROWS - fixedRows))
+    {
+        return ssd1306_request_invalid;
     }
-    prepareSetPixelsFromRAM();
-    return createSingleCommandRequest(result);
+    return queueCommand(command, sizeof(command), result);
 }
 
-static void prepareSetPixelsFromRAM(void)
+enum ssd1306_request_t ssd1306_setVerticalScrollArea(uint8_t fixedRows, uint8_t scrollRows,
+                                                     enum ssd1306_result_t *result)
 {
-    createSingleCommand(SSD1306_SET_USE_PIXELS_FROM_RAM, 2);
+    return ssd1306_setVerticalScrollAreaOn(selectedDisplay, fixedRows, scrollRows, result);
 }
 
-enum ssd1306_request_t ssd1306_setAllPixelsActive(enum ssd1306_result_t *result)
+enum ssd1306_request_t ssd1306_activateScrollOn(uint8_t display, enum ssd1306_result_t *result)
 {
-    if (self.state != ssd1306_idle_state)
+    const uint8_t command[] = {SSD1306_ACTIVATE_SCROLL};
+    enum ssd1306_request_t request;
+#if (SSD1306_GDDRAM_SHADOW)
+    bool scrollActive;
+#endif
+
+    if (!useDisplay(display))
     {
-        return ssd1306_request_busy;
+        return ssd1306_request_invalid;
+    }
+#if (SSD1306_GDDRAM_SHADOW)
+    scrollActive = (self->shadow.valid & SHADOW_SCROLL) && self->shadow.scrollActive;
+#endif
+    request = queueSetting(SHADOW_SCROLL, &self->shadow.scrollActive, true,
+                           command, sizeof(command), result);
+#if (SSD1306_GDDRAM_SHADOW)
+    if ((request == ssd1306_request_ok) && !scrollActive)
+    {
+        // The scroll moves the data in the display RAM
+        clearGddramShadow();
     }
-    prepareSetPixelsEntireDisplayOn();
-    return createSingleCommandRequest(result);
+#endif
+    return request;
 }
 
-static void prepareSetPixelsEntireDisplayOn(void)
+enum ssd1306_request_t ssd1306_activateScroll(enum ssd1306_result_t *result)
 {
-    createSingleCommand(SSD1306_SET_PIXELS_ENTIRE_DISPLAY_ON, 2);
+    return ssd1306_activateScrollOn(selectedDisplay, result);
 }
 
-enum ssd1306_request_t ssd1306_setNormalDisplay(enum ssd1306_result_t *result)
+enum ssd1306_request_t ssd1306_deactivateScrollOn(uint8_t display, enum ssd1306_result_t *result)
 {
-    if (self.state != ssd1306_idle_state)
+    const uint8_t command[] = {SSD1306_DEACTIVATE_SCROLL};
+
+    if (!useDisplay(display))
     {
-        return ssd1306_request_busy;
+        return ssd1306_request_invalid;
     }
-    prepareSetNormalDisplay();
-    return createSingleCommandRequest(result);
+    return queueSetting(SHADOW_SCROLL, &self->shadow.scrollActive, false,
+                        command, sizeof(command), result);
 }
 
-static void prepareSetNormalDisplay(void)
+enum ssd1306_request_t ssd1306_deactivateScroll(enum ssd1306_result_t *result)
 {
-    createSingleCommand(SSD1306_SET_NORMAL_DISPLAY, 2);
+    return ssd1306_deactivateScrollOn(selectedDisplay, result);
 }
 
-enum ssd1306_request_t ssd1306_setInvertedDisplay(enum ssd1306_result_t *result)
+/*
+ * Advanced graphic commands
+ */
+enum ssd1306_request_t ssd1306_setFadeOutOn(uint8_t display, enum ssd1306_fade_mode_t mode, uint8_t interval,
+                                            enum ssd1306_result_t *result)
 {
-    if (self.state != ssd1306_idle_state)
+    static const uint8_t fadeModes[] = {SSD1306_FADE_OUT_DISABLE, SSD1306_FADE_OUT_ENABLE,
+                                        SSD1306_BLINKING_ENABLE};
+    uint8_t command[2] = {SSD1306_SET_FADE_OUT_AND_BLINKING, 0};
+
+    if (!useDisplay(display))
     {
-        return ssd1306_request_busy;
+        return ssd1306_request_invalid;
     }
-    prepareSetInvertedDisplay();
-    return createSingleCommandRequest(result);
+    if ((mode > ssd1306_fade_blink) || (interval > SSD1306_FADE_INTERVAL_MAX))
+    {
+        return ssd1306_request_invalid;
+    }
+    command[1] = fadeModes[mode] | interval;
+    return queueSetting(SHADOW_FADE, &self->shadow.fade, command[1],
+                        command, sizeof(command), result);
 }
 
-static void prepareSetInvertedDisplay(void)
+enum ssd1306_request_t ssd1306_setFadeOut(enum ssd1306_fade_mode_t mode, uint8_t interval,
+                                          enum ssd1306_result_t *result)
 {
-    createSingleCommand(SSD1306_SET_INVERTED_DISPLAY, 2);
+    return ssd1306_setFadeOutOn(selectedDisplay, mode, interval, result);
 }
 
-enum ssd1306_request_t ssd1306_setDisplayOn(enum ssd1306_result_t *result)
+enum ssd1306_request_t ssd1306_enableZoomInOn(uint8_t display, enum ssd1306_result_t *result)
 {
-    if (self.state != ssd1306_idle_state)
+    const uint8_t command[] = {SSD1306_SET_ZOOM_IN, SSD1306_ZOOM_IN_ENABLE};
+
+    if (!useDisplay(display))
     {
-        return ssd1306_request_busy;
+        return ssd1306_request_invalid;
     }
-    prepareSetDisplayOn();
-    return createSingleCommandRequest(result);
+    return queueSetting(SHADOW_ZOOM, &self->shadow.zoomIn, true,
+                        command, sizeof(command), result);
 }
 
-static void prepareSetDisplayOn(void)
+enum ssd1306_request_t ssd1306_enableZoomIn(enum ssd1306_result_t *result)
 {
-    createSingleCommand(SSD1306_DISPLAY_ON, 2);
+    return ssd1306_enableZoomInOn(selectedDisplay, result);
 }
 
-enum ssd1306_request_t ssd1306_setDisplaySleep(enum ssd1306_result_t *result)
+enum ssd1306_request_t ssd1306_disableZoomInOn(uint8_t display, enum ssd1306_result_t *result)
 {
-    if (self.state != ssd1306_idle_state)
+    const uint8_t command[] = {SSD1306_SET_ZOOM_IN, SSD1306_ZOOM_IN_DISABLE};
+
+    if (!useDisplay(display))
     {
-        return ssd1306_request_busy;
+        return ssd1306_request_invalid;
     }
-    prepareSetDisplaySleep();
-    return createSingleCommandRequest(result);
+    return queueSetting(SHADOW_ZOOM, &self->shadow.zoomIn, false,
+                        command, sizeof(command), result);
 }
 
-static void prepareSetDisplaySleep(void)
+enum ssd1306_request_t ssd1306_disableZoomIn(enum ssd1306_result_t *result)
 {
-    createSingleCommand(SSD1306_DISPLAY_SLEEP, 2);
+    return ssd1306_disableZoomInOn(selectedDisplay, result);
 }
 
-/*
- * Scrolling commands
- */
-
 /*
  * Addressing setting commands
  */
-void ssd1306_setMemoryAddressingMode(enum ssd1306_addressing_mode_t mode)
+void ssd1306_setMemoryAddressingModeOn(uint8_t display, enum ssd1306_addressing_mode_t mode)
 {
+    if (!useDisplay(display))
+    {
+        return;
+    }
     if((ssd1306_addressing_horizontal <= mode) && (mode <= ssd1306_addressing_page))
     {
-        self.addressingMode = mode;
+        self->addressingMode = mode;
     }
 }
 
-static void prepareSetAddressingMode(uint8_t mode)
+void ssd1306_setMemoryAddressingMode(enum ssd1306_addressing_mode_t mode)
 {
-    createSingleCommand(SSD1306_SET_MEMORY_ADDRESSING_MODE, 3);
-    self.commandBuffer[2] = mode;
+    ssd1306_setMemoryAddressingModeOn(selectedDisplay, mode);
 }
 
-void ssd1306_setColumnAddress(uint8_t startAddress, uint8_t endAddress)
+void ssd1306_setColumnAddressOn(uint8_t display, uint8_t startAddress, uint8_t endAddress)
 {
-    if (startAddress < 128)
+    if (!useDisplay(display))
+    {
+        return;
+    }
+    if (startAddress < self->width)
     {
-        self.colStart = startAddress;
+        self->colStart = startAddress;
     }
-    if (endAddress < 128)
+    if (endAddress < self->width)
     {
-        self.colEnd = endAddress;
+        self->colEnd = endAddress;
     }
 }
 
-static void prepareSetColumnAddress(void)
+void ssd1306_setColumnAddress(uint8_t startAddress, uint8_t endAddress)
+{
+    ssd1306_setColumnAddressOn(selectedDisplay, startAddress, endAddress);
+}
+
+void ssd1306_setPageAddressOn(uint8_t display, uint8_t startAddress, uint8_t endAddress)
 {
-    if (self.addressingMode == SSD1306_HORIZONTAL_ADDRESSING_MODE ||
-        self.addressingMode == SSD1306_VERTICAL_ADDRESSING_MODE)
+    if (!useDisplay(display))
     {
-        createSingleCommand(SSD1306_SET_COLUMN_ADDRESS, 4);
-        self.commandBuffer[2] = self.colStart;
-        self.commandBuffer[3] = self.colEnd;
+        return;
     }
-    else
+    if (startAddress < SSD1306_GDDRAM_PAGES)
+    {
+        self->pageStart = startAddress;
+    }
+    if (endAddress < SSD1306_GDDRAM_PAGES)
     {
-        // Handle page addressing mode
+        self->pageEnd = endAddress;
     }
 }
 
 void ssd1306_setPageAddress(uint8_t startAddress, uint8_t endAddress)
 {
-    if (startAddress < 8)
+    ssd1306_setPageAddressOn(selectedDisplay, startAddress, endAddress);
+}
+
+/*
+ * Prepare the commands that set the addressing mode and the window before
+ * graphics data is sent. The commands are sent in one transaction and only if
+ * they change the configuration of the controller.
+ */
+static void prepareSetWindow(void)
+{
+    self->commandLen = 0;
+#if (SSD1306_GDDRAM_SHADOW)
+    // The addressing mode and the RAM pointer are set before each run of
+    // changed data instead
+    self->streamColumn = self->colStart;
+    self->streamPage = self->pageStart;
+    self->runLeft = 0;
+#else
+    appendAddressingMode();
+    if (self->addressingMode == SSD1306_HORIZONTAL_ADDRESSING_MODE ||
+        self->addressingMode == SSD1306_VERTICAL_ADDRESSING_MODE)
     {
-        self.pageStart = startAddress;
+        appendWindow(self->colStart, self->colEnd, self->pageStart, self->pageEnd);
     }
-    if (endAddress < 8)
+    else
     {
-        self.pageEnd = endAddress;
+        // In page addressing mode, the RAM pointer is set for each page
+        self->dataPage = self->pageStart;
+        self->pageBytesLeft = 0;
     }
+#endif
 }
 
-static void prepareSetPageAddress(void)
+static void appendAddressingMode(void)
 {
-    if (self.addressingMode == SSD1306_HORIZONTAL_ADDRESSING_MODE ||
-        self.addressingMode == SSD1306_VERTICAL_ADDRESSING_MODE)
+    const uint8_t modeCommand[] = {SSD1306_SET_MEMORY_ADDRESSING_MODE, self->addressingMode};
+
+    if (!(self->shadow.valid & SHADOW_ADDRESSING_MODE) || (self->shadow.addressingMode != self->addressingMode))
     {
-        createSingleCommand(SSD1306_SET_PAGE_ADDRESS, 4);
-        self.commandBuffer[2] = self.pageStart;
-        self.commandBuffer[3] = self.pageEnd;
+        appendCommand(modeCommand, sizeof(modeCommand));
+        self->shadow.addressingMode = self->addressingMode;
+        self->shadow.valid |= SHADOW_ADDRESSING_MODE;
+        self->shadow.valid &= ~(SHADOW_WINDOW | SHADOW_PAGE_POINTER);
     }
-    else
+}
+
+/*
+ * Append the column and page address commands for a window in horizontal or
+ * vertical addressing mode. A command is skipped if it would not change the
+ * window and the RAM pointer is at the start of the window.
+ */
+static void appendWindow(uint8_t colStart, uint8_t colEnd, uint8_t pageStart, uint8_t pageEnd)
+{
+    const uint8_t columnCommand[] = {SSD1306_SET_COLUMN_ADDRESS, colStart + self->columnOffset,
+                                     colEnd + self->columnOffset};
+    const uint8_t pageCommand[] = {SSD1306_SET_PAGE_ADDRESS, pageStart, pageEnd};
+    bool atWindowStart = (self->shadow.valid & SHADOW_WINDOW) && (self->shadow.windowPosition == 0);
+
+    if (!atWindowStart || (self->shadow.colStart != colStart) || (self->shadow.colEnd != colEnd))
+    {
+        appendCommand(columnCommand, sizeof(columnCommand));
+    }
+    if (!atWindowStart || (self->shadow.pageStart != pageStart) || (self->shadow.pageEnd != pageEnd))
     {
-        // Handle page addressing mode
+        appendCommand(pageCommand, sizeof(pageCommand));
     }
+    self->shadow.colStart = colStart;
+    self->shadow.colEnd = colEnd;
+    self->shadow.pageStart = pageStart;
+    self->shadow.pageEnd = pageEnd;
+    self->shadow.windowPosition = 0;
+    self->shadow.valid |= SHADOW_WINDOW;
 }
 
 /*
- * Hardware configuration commands
+ * Append the short header that moves the RAM pointer to the page and column in
+ * page addressing mode. The page start and the column start commands are only
+ * sent if the pointer is not already there.
  */
-enum ssd1306_request_t ssd1306_setDisplayStartLine(uint8_t line, enum ssd1306_result_t *result)
+static void appendPageHeader(uint8_t page, uint8_t column)
 {
-    if (self.state != ssd1306_idle_state)
+    const uint8_t ramColumn = column + self->columnOffset;
+    const uint8_t pageCommand[] = {SSD1306_SET_PAGE_START | page};
+    const uint8_t columnCommand[] = {SSD1306_SET_LOWER_COLUMN_START | (ramColumn & 0x0Fu),
+                                     SSD1306_SET_HIGHER_COLUMN_START | (ramColumn >> 4)};
+    bool pointerKnown = self->shadow.valid & SHADOW_PAGE_POINTER;
+
+    if (!pointerKnown || (self->shadow.pointerPage != page))
     {
-        return ssd1306_request_busy;
+        appendCommand(pageCommand, sizeof(pageCommand));
+    }
+    if (!pointerKnown || (self->shadow.pointerColumn != column))
+    {
+        appendCommand(columnCommand, sizeof(columnCommand));
     }
-    prepareSetDisplayStartLine(line);
-    return createSingleCommandRequest(result);
+    self->shadow.pointerPage = page;
+    self->shadow.pointerColumn = column;
+    self->shadow.valid |= SHADOW_PAGE_POINTER;
 }
 
-static void prepareSetDisplayStartLine(uint8_t line)
+#if !(SSD1306_GDDRAM_SHADOW)
+/*
+ * Number of columns in the window.
+ */
+static uint8_t windowWidth(void)
 {
-    if (line <= SSD1306_DISPLAY_START_LINE_MAX)
+    if (self->colEnd < self->colStart)
     {
-        createSingleCommand(SSD1306_SET_DISPLAY_START_LINE | line, 2);
+        return SSD1306_GDDRAM_COLUMNS - self->columnOffset - self->colStart;
     }
-    else
+    return self->colEnd - self->colStart + 1;
+}
+#endif
+
+/*
+ * Number of bytes in the window. Returns 0 if the window is not valid.
+ */
+static uint16_t windowSize(void)
+{
+    if ((self->shadow.colEnd < self->shadow.colStart) || (self->shadow.pageEnd < self->shadow.pageStart))
     {
-        // Handle error
-        // Set error code and let the error handler abort the operation and return to idle
+        return 0;
     }
+    return (uint16_t)(self->shadow.colEnd - self->shadow.colStart + 1) *
+           (uint16_t)(self->shadow.pageEnd - self->shadow.pageStart + 1);
 }
 
-enum ssd1306_request_t ssd1306_setSegmentRemap_0(enum ssd1306_result_t *result)
+static void advanceRamPointer(uint16_t length)
 {
-    if (self.state != ssd1306_idle_state)
+    uint16_t size = windowSize();
+
+    if (self->addressingMode == SSD1306_PAGE_ADDRESSING_MODE)
     {
-        return ssd1306_request_busy;
+        // The column wraps within the page at the end of the RAM
+        if (self->shadow.pointerColumn + length < SSD1306_GDDRAM_COLUMNS - self->columnOffset)
+        {
+            self->shadow.pointerColumn += length;
+        }
+        else
+        {
+            self->shadow.valid &= ~SHADOW_PAGE_POINTER;
+        }
+        return;
+    }
+
+    if (size == 0)
+    {
+        self->shadow.valid &= ~SHADOW_WINDOW;
+        return;
+    }
+    self->shadow.windowPosition = (uint16_t)((self->shadow.windowPosition + length) % size);
+}
+/*
+ * Hardware configuration commands
+ */
+enum ssd1306_request_t ssd1306_setDisplayStartLineOn(uint8_t display, uint8_t line, enum ssd1306_result_t *result)
+{
+    const uint8_t command[] = {SSD1306_SET_DISPLAY_START_LINE | line};
+
+    if (!useDisplay(display))
+    {
+        return ssd1306_request_invalid;
     }
-    prepareSetSegmentRemap_0();
-    return createSingleCommandRequest(result);
+    if (line > SSD1306_DISPLAY_START_LINE_MAX)
+    {
+        return ssd1306_request_invalid;
+    }
+    return queueCommand(command, sizeof(command), result);
 }
 
-static void prepareSetSegmentRemap_0(void)
+enum ssd1306_request_t ssd1306_setDisplayStartLine(uint8_t line, enum ssd1306_result_t *result)
 {
-    createSingleCommand(SSD1306_SEGMENT_REMAP_0, 2);
+    return ssd1306_setDisplayStartLineOn(selectedDisplay, line, result);
 }
 
-enum ssd1306_request_t ssd1306_setSegmentRemap_127(enum ssd1306_result_t *result)
+enum ssd1306_request_t ssd1306_setSegmentRemap_0On(uint8_t display, enum ssd1306_result_t *result)
 {
-    if (self.state != ssd1306_idle_state)
+    const uint8_t command[] = {SSD1306_SEGMENT_REMAP_0};
+
+    if (!useDisplay(display))
     {
-        return ssd1306_request_busy;
+        return ssd1306_request_invalid;
     }
-    prepareSetSegmentRemap_127();
-    return createSingleCommandRequest(result);
+    return queueOrientationCommand(command, result);
 }
 
-static void prepareSetSegmentRemap_127(void)
+enum ssd1306_request_t ssd1306_setSegmentRemap_0(enum ssd1306_result_t *result)
 {
-    createSingleCommand(SSD1306_SEGMENT_REMAP_127, 2);
+    return ssd1306_setSegmentRemap_0On(selectedDisplay, result);
 }
 
-enum ssd1306_request_t ssd1306_setMultiplexRatio(uint8_t ratio, enum ssd1306_result_t *result)
+enum ssd1306_request_t ssd1306_setSegmentRemap_127On(uint8_t display, enum ssd1306_result_t *result)
 {
-    if (self.state != ssd1306_idle_state)
+    const uint8_t command[] = {SSD1306_SEGMENT_REMAP_127};
+
+    if (!useDisplay(display))
     {
-        return ssd1306_request_busy;
+        return ssd1306_request_invalid;
     }
-    prepareSetMultiPlexRatioCommand(ratio);
-    return createSingleCommandRequest(result);
+    return queueOrientationCommand(command, result);
+}
+
+enum ssd1306_request_t ssd1306_setSegmentRemap_127(enum ssd1306_result_t *result)
+{
+    return ssd1306_setSegmentRemap_127On(selectedDisplay, result);
 }
 
-static void prepareSetMultiPlexRatioCommand(uint8_t ratio)
+enum ssd1306_request_t ssd1306_setMultiplexRatioOn(uint8_t display, uint8_t ratio, enum ssd1306_result_t *result)
 {
-    if((ratio>=SSD1306_MUX_MIN_VALUE) && (ratio<=SSD1306_MUX_MAX_VALUE))
+    const uint8_t command[] = {SSD1306_SET_MULTIPLEX_RATIO, ratio - 1};
+
+    if (!useDisplay(display))
     {
-        createSingleCommand(SSD1306_SET_MULTIPLEX_RATIO, 3);
-        self.commandBuffer[2] = ratio - 1;
+        return ssd1306_request_invalid;
     }
-    else
+    if ((ratio < SSD1306_MUX_MIN_VALUE) || (ratio > SSD1306_MUX_MAX_VALUE))
     {
-        // Handle error
-        // Set error code and let the error handler abort the operation and return to idle
+        return ssd1306_request_invalid;
     }
+    return queueCommand(command, sizeof(command), result);
 }
 
-enum ssd1306_request_t ssd1306_setComOutputScanDirectionNormal(enum ssd1306_result_t *result)
+enum ssd1306_request_t ssd1306_setMultiplexRatio(uint8_t ratio, enum ssd1306_result_t *result)
+{
+    return ssd1306_setMultiplexRatioOn(selectedDisplay, ratio, result);
+}
+
+enum ssd1306_request_t ssd1306_setComOutputScanDirectionNormalOn(uint8_t display, enum ssd1306_result_t *result)
 {
-    if (self.state != ssd1306_idle_state)
+    const uint8_t command[] = {SSD1306_SET_COM_OUTPUT_SCAN_DIRECTION_NORMAL};
+
+    if (!useDisplay(display))
     {
-        return ssd1306_request_busy;
+        return ssd1306_request_invalid;
     }
-    prepareSetComOutputScanDirectionNormal();
-    return createSingleCommandRequest(result);
+    return queueOrientationCommand(command, result);
+}
+
+enum ssd1306_request_t ssd1306_setComOutputScanDirectionNormal(enum ssd1306_result_t *result)
+{
+    return ssd1306_setComOutputScanDirectionNormalOn(selectedDisplay, result);
 }
 
-static void prepareSetComOutputScanDirectionNormal(void)
+enum ssd1306_request_t ssd1306_setComOutputScanDirectionRemappedOn(uint8_t display, enum ssd1306_result_t *result)
 {
-    createSingleCommand(SSD1306_SET_COM_OUTPUT_SCAN_DIRECTION_NORMAL, 2);
+    const uint8_t command[] = {SSD1306_SET_COM_OUTPUT_SCAN_DIRECTION_REMAPPED};
+
+    if (!useDisplay(display))
+    {
+        return ssd1306_request_invalid;
+    }
+    return queueOrientationCommand(command, result);
 }
 
 enum ssd1306_request_t ssd1306_setComOutputScanDirectionRemapped(enum ssd1306_result_t *result)
 {
-    if (self.state != ssd1306_idle_state)
+    return ssd1306_setComOutputScanDirectionRemappedOn(selectedDisplay, result);
+}
+
+enum ssd1306_request_t ssd1306_setOrientationOn(uint8_t display, enum ssd1306_orientation_t orientation,
+                                                enum ssd1306_result_t *result)
+{
+    enum ssd1306_request_t request;
+    bool segmentRemapChanged;
+
+    if (!useDisplay(display))
     {
-        return ssd1306_request_busy;
+        return ssd1306_request_invalid;
+    }
+    if (orientation > ssd1306_orientation_mirrored_vertical)
+    {
+        return ssd1306_request_invalid;
+    }
+    segmentRemapChanged = !(self->shadow.valid & SHADOW_ORIENTATION) ||
+                          (orientationCommands[self->shadow.orientation][0] != orientationCommands[orientation][0]);
+    request = queueSetting(SHADOW_ORIENTATION, &self->shadow.orientation, orientation,
+                           orientationCommands[orientation], 2, result);
+    if ((request == ssd1306_request_ok) && segmentRemapChanged)
+    {
+        segmentRemapQueued();
     }
-    prepareSetComOutputScanDirectionRemapped();
-    return createSingleCommandRequest(result);
+    return request;
 }
 
-static void prepareSetComOutputScanDirectionRemapped(void)
+enum ssd1306_request_t ssd1306_setOrientation(enum ssd1306_orientation_t orientation,
+                                              enum ssd1306_result_t *result)
 {
-    createSingleCommand(SSD1306_SET_COM_OUTPUT_SCAN_DIRECTION_REMAPPED, 2);
+    return ssd1306_setOrientationOn(selectedDisplay, orientation, result);
 }
 
-enum ssd1306_request_t ssd1306_setDisplayOffset (uint8_t offset, enum ssd1306_result_t *result)
+/*
+ * Queue a segment remap or COM scan direction command. The orientation in the
+ * shadow is not known after the command.
+ */
+static enum ssd1306_request_t queueOrientationCommand(const uint8_t *command, enum ssd1306_result_t *result)
 {
-    if (self.state != ssd1306_idle_state)
+    enum ssd1306_request_t request = queueCommand(command, 1, result);
+
+    if (request == ssd1306_request_ok)
     {
-        return ssd1306_request_busy;
+        self->shadow.valid &= ~SHADOW_ORIENTATION;
+        if ((command[0] == SSD1306_SEGMENT_REMAP_0) || (command[0] == SSD1306_SEGMENT_REMAP_127))
+        {
+            segmentRemapQueued();
+        }
     }
-    prepareSetDisplayOffset(offset);
-    return createSingleCommandRequest(result);
+    return request;
+}
+
+/*
+ * The segment remap only applies to data written after the command, so the
+ * columns of the display RAM no longer match the columns that are written.
+ */
+static void segmentRemapQueued(void)
+{
+#if (SSD1306_GDDRAM_SHADOW)
+    clearGddramShadow();
+#endif
 }
 
-static void prepareSetDisplayOffset (uint8_t offset)
+enum ssd1306_request_t ssd1306_setDisplayOffsetOn(uint8_t display, uint8_t offset, enum ssd1306_result_t *result)
 {
-    if (offset <= SSD1306_DISPLAY_OFFSET_MAX_VALUE)
+    const uint8_t command[] = {SSD1306_SET_DISPLAY_OFFSET, offset};
+
+    if (!useDisplay(display))
     {
-        createSingleCommand(SSD1306_SET_DISPLAY_OFFSET, 3);
-        self.commandBuffer[2] = offset;
+        return ssd1306_request_invalid;
     }
-    else
+    if (offset > SSD1306_DISPLAY_OFFSET_MAX_VALUE)
     {
-        // Handle error
-        // Set error code and let the error handler abort the operation and return to idle
+        return ssd1306_request_invalid;
     }
+    return queueCommand(command, sizeof(command), result);
 }
 
-enum ssd1306_request_t ssd1306_setComPinsHardwareConfig(bool useAltComPinConf, bool enableLeftRightRemap, enum ssd1306_result_t *result)
+enum ssd1306_request_t ssd1306_setDisplayOffset (uint8_t offset, enum ssd1306_result_t *result)
+{
+    return ssd1306_setDisplayOffsetOn(selectedDisplay, offset, result);
+}
+
+enum ssd1306_request_t ssd1306_setComPinsHardwareConfigOn(uint8_t display, bool useAltComPinConf, bool enableLeftRightRemap, enum ssd1306_result_t *result)
 {
-    if (self.state != ssd1306_idle_state)
+    const uint8_t command[] = {SSD1306_SET_COM_PINS_HARDWARE_CONFIGURATION,
+                               SSD1306_COM_PINS_HARDWARE_BASE_VALUE |
+                               ((uint8_t)useAltComPinConf) << 4 |
+                               ((uint8_t)enableLeftRightRemap) << 5};
+
+    if (!useDisplay(display))
     {
-        return ssd1306_request_busy;
+        return ssd1306_request_invalid;
     }
-    prepareSetComPinsHardwareConfig(useAltComPinConf, enableLeftRightRemap);
-    return createSingleCommandRequest(result);
+    return queueCommand(command, sizeof(command), result);
 }
 
-static void prepareSetComPinsHardwareConfig(bool useAltComPinConf, bool enableLeftRightRemap)
+enum ssd1306_request_t ssd1306_setComPinsHardwareConfig(bool useAltComPinConf, bool enableLeftRightRemap, enum ssd1306_result_t *result)
 {
-    createSingleCommand(SSD1306_SET_COM_PINS_HARDWARE_CONFIGURATION, 3);
-    self.commandBuffer[2] = SSD1306_COM_PINS_HARDWARE_BASE_VALUE |
-                            ((uint8_t)useAltComPinConf) << 4 |
-                            ((uint8_t)enableLeftRightRemap) << 5;
+    return ssd1306_setComPinsHardwareConfigOn(selectedDisplay, useAltComPinConf, enableLeftRightRemap, result);
 }
 
 /*
  * Timing and Driving Scheme Setting commands
  */
-enum ssd1306_request_t ssd1306_setDisplayClock(uint8_t divideRatio, uint8_t oscillatorFrequency, enum ssd1306_result_t *result)
+enum ssd1306_request_t ssd1306_setDisplayClockOn(uint8_t display, uint8_t divideRatio, uint8_t oscillatorFrequency, enum ssd1306_result_t *result)
 {
-    if (self.state != ssd1306_idle_state)
-    {
-        return ssd1306_request_busy;
-    }
-    prepareSetDisplayClock(divideRatio, oscillatorFrequency);
-    return createSingleCommandRequest(result);
-}
+    const uint8_t command[] = {SSD1306_SET_CLOCK_DIVIDER_AND_OSCILLATOR,
+                               (divideRatio - 1) | (oscillatorFrequency << 4)};
 
-static void prepareSetDisplayClock(uint8_t divideRatio, uint8_t oscillatorFrequency)
-{
-    if ((divideRatio >= SSD1306_CLOCK_DIVIDER_MIN_VALUE) &&
-        (divideRatio <= SSD1306_CLOCK_DIVIDER_MAX_VALUE) &&
-        (oscillatorFrequency <= SSD1306_OSCILLATOR_FREQUENCY_MAX_VALUE))
+    if (!useDisplay(display))
     {
-        createSingleCommand(SSD1306_SET_CLOCK_DIVIDER_AND_OSCILLATOR, 3);
-        self.commandBuffer[2] = (divideRatio - 1) | (oscillatorFrequency << 4);
+        return ssd1306_request_invalid;
     }
-    else
+    if ((divideRatio < SSD1306_CLOCK_DIVIDER_MIN_VALUE) ||
+        (divideRatio > SSD1306_CLOCK_DIVIDER_MAX_VALUE) ||
+        (oscillatorFrequency > SSD1306_OSCILLATOR_FREQUENCY_MAX_VALUE))
     {
-        // Handle error
-        // Set error code and let the error handler abort the operation and return to idle
+        return ssd1306_request_invalid;
     }
+    return queueCommand(command, sizeof(command), result);
+}
+
+enum ssd1306_request_t ssd1306_setDisplayClock(uint8_t divideRatio, uint8_t oscillatorFrequency, enum ssd1306_result_t *result)
+{
+    return ssd1306_setDisplayClockOn(selectedDisplay, divideRatio, oscillatorFrequency, result);
 }
 
 /*
  * CHARGE PUMP REGULATOR COMMANDS
  */
-enum ssd1306_request_t ssd1306_enableChargePump(enum ssd1306_result_t *result)
+enum ssd1306_request_t ssd1306_enableChargePumpOn(uint8_t display, enum ssd1306_result_t *result)
 {
-    if (self.state != ssd1306_idle_state)
+    const uint8_t command[] = {SSD1306_CHARGE_PUMP_SETTING, SSD1306_CHARGE_PUMP_ENABLE};
+
+    if (!useDisplay(display))
     {
-        return ssd1306_request_busy;
+        return ssd1306_request_invalid;
     }
-    prepareEnableChargePump();
-    return createSingleCommandRequest(result);
+    return queueCommand(command, sizeof(command), result);
 }
 
-static void prepareEnableChargePump(void)
+enum ssd1306_request_t ssd1306_enableChargePump(enum ssd1306_result_t *result)
 {
-    createSingleCommand(SSD1306_CHARGE_PUMP_SETTING, 3);
-    self.commandBuffer[2] = SSD1306_CHARGE_PUMP_ENABLE;
+    return ssd1306_enableChargePumpOn(selectedDisplay, result);
 }
 
-enum ssd1306_request_t ssd1306_disableChargePump(enum ssd1306_result_t *result)
+enum ssd1306_request_t ssd1306_disableChargePumpOn(uint8_t display, enum ssd1306_result_t *result)
 {
-    if (self.state != ssd1306_idle_state)
+    const uint8_t command[] = {SSD1306_CHARGE_PUMP_SETTING, SSD1306_CHARGE_PUMP_DISABLE};
+
+    if (!useDisplay(display))
     {
-        return ssd1306_request_busy;
+        return ssd1306_request_invalid;
     }
-    prepareDisableChargePump();
-    return createSingleCommandRequest(result);
+    return queueCommand(command, sizeof(command), result);
 }
 
-static void prepareDisableChargePump(void)
+enum ssd1306_request_t ssd1306_disableChargePump(enum ssd1306_result_t *result)
 {
-    createSingleCommand(SSD1306_CHARGE_PUMP_SETTING, 3);
-    self.commandBuffer[2] = SSD1306_CHARGE_PUMP_DISABLE;
+    return ssd1306_disableChargePumpOn(selectedDisplay, result);
 }
 
 /*
  * DATA SEND
  */
+enum ssd1306_request_t ssd1306_sendGraphicsDataOn(uint8_t display, uint8_t *buffer, uint16_t len, enum ssd1306_result_t *result)
+{
+    if (!useDisplay(display))
+    {
+        return ssd1306_request_invalid;
+    }
+    if (self->state == ssd1306_idle_state)
+    {
+        self->bufferSpan.data = buffer;
+        self->bufferSpan.len = len;
+    }
+    return ssd1306_sendGraphicsSpansOn(display, &self->bufferSpan, 1, result);
+}
+
 enum ssd1306_request_t ssd1306_sendGraphicsData(uint8_t *buffer, uint16_t len, enum ssd1306_result_t *result)
 {
-    if (self.state == ssd1306_idle_state)
+    return ssd1306_sendGraphicsDataOn(selectedDisplay, buffer, len, result);
+}
+
+enum ssd1306_request_t ssd1306_sendGraphicsSpansOn(uint8_t display, const struct ssd1306_data_span_t *spans, uint8_t count,
+                                                   enum ssd1306_result_t *result)
+{
+    if (!useDisplay(display))
+    {
+        return ssd1306_request_invalid;
+    }
+    if (self->state == ssd1306_idle_state)
     {
-        self.graphicsData = buffer;
-        self.dataLen = len;
-        self.state = ssd1306_send_graphics_data_state;
-        self.operationResult = result;
-        self.operationStep = ssd1306_data_set_col_position_step;
+        self->spans = spans;
+        self->spanCount = count;
+        self->spanIndex = 0;
+        self->spanOffset = 0;
+#if !(SSD1306_GDDRAM_SHADOW)
+        self->dataAcked = 0;
+#endif
+        self->state = ssd1306_send_graphics_data_state;
+        self->operationResult = result;
+        *self->operationResult = ssd1306_result_processing;
+        self->operationStep = ssd1306_data_set_window_step;
         return ssd1306_request_ok;
     }
     return ssd1306_request_busy;
 }
+
+enum ssd1306_request_t ssd1306_sendGraphicsSpans(const struct ssd1306_data_span_t *spans, uint8_t count,
+                                                 enum ssd1306_result_t *result)
+{
+    return ssd1306_sendGraphicsSpansOn(selectedDisplay, spans, count, result);
+}
+
+uint16_t ssd1306_getDataProgressOn(uint8_t display)
+{
+#if (SSD1306_GDDRAM_SHADOW)
+    uint16_t progress;
+#endif
+
+    if (!useDisplay(display))
+    {
+        return 0;
+    }
+#if (SSD1306_GDDRAM_SHADOW)
+    // The position in the spans is moved past the data of a transfer when it is
+    // prepared, and past the unchanged data that is skipped
+    progress = self->spanOffset;
+    for (uint8_t i=0; i<self->spanIndex; i++)
+    {
+        progress += self->spans[i].len;
+    }
+    if (self->commandType == send_data_command)
+    {
+        progress -= self->dataLen;
+    }
+    return progress;
+#else
+    return self->dataAcked;
+#endif
+}
+
+uint16_t ssd1306_getDataProgress(void)
+{
+    return ssd1306_getDataProgressOn(selectedDisplay);
+}
@@ -4,7 +4,20 @@
 /*
  * General
  */
-#define SSD1306_COMMAND_BUFFER_SIZE  4u
+#define SSD1306_COMMAND_BUFFER_SIZE  16u
+#define SSD1306_COMMAND_MAX_LEN      7u
+
+/*
+ * Size of the display RAM (GDDRAM)
+ */
+#define SSD1306_GDDRAM_COLUMNS                            128u
+#define SSD1306_GDDRAM_PAGES                              8u
+
+/*
+ * Buses that can be selected with SSD1306_BUS in the config file
+ */
+#define SSD1306_BUS_I2C                                   0u
+#define SSD1306_BUS_SPI                                   1u
 
 /*
  * I2C defines
@@ -31,6 +44,30 @@
 /*
  * Scrolling commands
  */
+#define SSD1306_RIGHT_HORIZONTAL_SCROLL                   0x26u
+#define SSD1306_LEFT_HORIZONTAL_SCROLL                    0x27u
+#define SSD1306_VERTICAL_AND_RIGHT_HORIZONTAL_SCROLL      0x29u
+#define SSD1306_VERTICAL_AND_LEFT_HORIZONTAL_SCROLL       0x2Au
+#define SSD1306_DEACTIVATE_SCROLL                         0x2Eu
+#define SSD1306_ACTIVATE_SCROLL                           0x2Fu
+#define SSD1306_SET_VERTICAL_SCROLL_AREA                  0xA3u
+#define SSD1306_SCROLL_DUMMY_BYTE_00                      0x00u
+#define SSD1306_SCROLL_DUMMY_BYTE_FF                      0xFFu
+#define SSD1306_SCROLL_PAGE_MAX                           0x07u
+#define SSD1306_VERTICAL_SCROLL_OFFSET_MAX                0x3Fu
+#define SSD1306_VERTICAL_SCROLL_AREA_MAX_ROWS             0x40u
+
+/*
+ * Advanced graphic commands
+ */
+#define SSD1306_SET_FADE_OUT_AND_BLINKING                 0x23u
+#define SSD1306_FADE_OUT_DISABLE                          0x00u
+#define SSD1306_FADE_OUT_ENABLE                           0x20u
+#define SSD1306_BLINKING_ENABLE                           0x30u
+#define SSD1306_FADE_INTERVAL_MAX                         0x0Fu
+#define SSD1306_SET_ZOOM_IN                               0xD6u
+#define SSD1306_ZOOM_IN_DISABLE                           0x00u
+#define SSD1306_ZOOM_IN_ENABLE                            0x01u
 
 /*
  * Addressing settings commands
@@ -41,6 +78,9 @@
 #define SSD1306_PAGE_ADDRESSING_MODE                      0x02u
 #define SSD1306_SET_COLUMN_ADDRESS                        0x21u
 #define SSD1306_SET_PAGE_ADDRESS                          0x22u
+#define SSD1306_SET_LOWER_COLUMN_START                    0x00u
+#define SSD1306_SET_HIGHER_COLUMN_START                   0x10u
+#define SSD1306_SET_PAGE_START                            0xB0u
 
 /*
  * Hardware configuration commands
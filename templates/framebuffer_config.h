@@ -1,16 +1,46 @@
 #ifndef FRAMEBUFFER_CONFIG_H
 #define FRAMEBUFFER_CONFIG_H
 
+#include "config/ssd1306_config.h"
+
 /*
  * The following parameters needs to be defined
  */
 
+// Number of panels that the framebuffer spans. The panels are placed side by
+// side, and panel n is SSD1306 display n (see ssd1306_addDisplay).
+#define GRAPHICS_PANELS         1u
+
+// Number of pixels for the axes (the geometry of the panels, max 256*255)
+#define FRAMEBUFFER_X_PIXELS    (SSD1306_WIDTH * GRAPHICS_PANELS)
+#define FRAMEBUFFER_Y_PIXELS    SSD1306_HEIGHT
+
 // Size (in bytes) of the framebuffer memory area
-#define FRAMEBUFFER_SIZE        1024u
+#define FRAMEBUFFER_SIZE        (FRAMEBUFFER_X_PIXELS * ((FRAMEBUFFER_Y_PIXELS + 7u) / 8u))
+
+// Max number of separate dirty areas. Changes far apart are kept in separate
+// areas and sent one by one. When there are more, the areas are merged.
+#define FRAMEBUFFER_DIRTY_AREAS 4u
+
+// Set to 1u to keep a second copy of the framebuffer (FRAMEBUFFER_SIZE more bytes
+// of RAM) that the data is sent from. The modified parts are copied to it when a
+// frame is sent, and drawing can continue while the frame is sent.
+#define FRAMEBUFFER_DOUBLE_BUFFER 0u
+
+// Cost model of the flush planner (see flush_planner.h), in the time it takes to
+// send one byte on the bus. FLUSH_COST_WINDOW is the cost of a window change:
+// the column and page address commands and their transaction. FLUSH_COST_TRANSFER
+// is the cost of starting a transaction for a chunk of data. The values are for
+// I2C (address and control byte, START and STOP). For SPI, use 8u and 1u.
+#define FLUSH_COST_WINDOW       12u
+#define FLUSH_COST_TRANSFER     3u
 
-// Number of pixels for the axes
-#define FRAMEBUFFER_X_PIXELS    128u
-#define FRAMEBUFFER_Y_PIXELS    64u
+// Set to 1u to write each frame to the hidden half of the display RAM and show
+// it by moving the display start line, so a half written frame is never shown.
+// The start line change is not synchronized with the display scan, so one scan
+// can still show parts of both frames (tearing). Only for panels with at most
+// 32 rows, where the display RAM holds two frames.
+#define GRAPHICS_PAGE_FLIP      0u
 
 
 #endif  // FRAMEBUFFER_CONFIG_H
@@ -0,0 +1,25 @@
+#ifndef I2C_ARBITER_CONFIG_H
+#define I2C_ARBITER_CONFIG_H
+
+/*
+ * Maximum number of drivers that share the I2C bus.
+ */
+#define I2C_ARBITER_MAX_CLIENTS         4u
+
+/*
+ * Number of rejected requests in a row after which a client gets the bus
+ * before clients with higher priority. Since the drivers retry a rejected
+ * request once per call of their run function, the value is approximately the
+ * maximum number of ticks that a client waits for the bus.
+ */
+#define I2C_ARBITER_LATENCY_BOUND       10u
+
+/*
+ * Priorities of the drivers in the repo. Higher value means higher priority.
+ * Small periodic sensor reads should have higher priority than bulk display
+ * data.
+ */
+#define I2C_ARBITER_PRIORITY_HMC5883L   2u
+#define I2C_ARBITER_PRIORITY_SSD1306    1u
+
+#endif  // I2C_ARBITER_CONFIG_H
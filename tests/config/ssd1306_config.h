@@ -3,11 +3,40 @@
 
 #include <stdbool.h>
 
+/*
+ * Bus used to communicate with the display: SSD1306_BUS_I2C or SSD1306_BUS_SPI
+ * (4-wire SPI with a D/C line, see ssd1306_setDataCommandLine). For SPI, the
+ * SSD1306_SPI_DEVICE is the device (chip select) used in the SPI transfers.
+ */
+#ifndef SSD1306_BUS
+#define SSD1306_BUS                                         SSD1306_BUS_I2C
+#endif
+#define SSD1306_SPI_DEVICE                                  0u
+
+/*
+ * Geometry of the panel (display 0). The width and height are the number of columns and rows
+ * that the panel shows. The column offset is the first column of the display RAM
+ * that is connected to the panel (e.g., 32 for 64x48 and 28 for 72x40 panels).
+ * The driver's column addresses start at the first shown column. Common panels
+ * are 128x64, 128x32, 96x16, 64x48 and 72x40. Panels with 32 or fewer rows
+ * normally use the sequential COM pin configuration (see below).
+ */
+#ifndef SSD1306_WIDTH
+#define SSD1306_WIDTH                                       128u
+#define SSD1306_HEIGHT                                      64u
+#define SSD1306_COLUMN_OFFSET                               0u
+#endif
+
+/*
+ * Number of displays that the driver can handle (see ssd1306_addDisplay). Each
+ * display uses its own state and command queue (and display RAM shadow).
+ */
+#define SSD1306_MAX_DISPLAYS                                2u
+
 /*
  * Default values that are used in the init display function.
  * See the datasheet (application note section) for more information.
  */
-#define SSD1306_DEFAULT_MUX_VALUE                           0x3Fu
 #define SSD1306_DEFAULT_DISPLAY_STARTLINE                   0x00u
 #define SSD1306_DEFAULT_DISPLAY_OFFSET                      0x00u
 #define SSD1306_DEFAULT_COM_HW_PIN_USE_ALT_COM_PIN_CONF     true
@@ -18,4 +47,52 @@
 #define SSD1306_DEFAULT_DISPLAY_CLOCK_DIVIDE_RATIO          0x01u
 #define SSD1306_DEFAULT_OSCILLATOR_FREQUENCY                0x08u
 
+/*
+ * Number of commands that can be waiting in the driver's command queue. Commands
+ * that are waiting in the queue when the bus becomes free are sent to the display
+ * in one transaction.
+ */
+#define SSD1306_COMMAND_QUEUE_SIZE                          8u
+
+/*
+ * Time in milliseconds from the init request until the init sequence is sent,
+ * to let the supply of the display settle after power on.
+ */
+#define SSD1306_POWER_ON_DELAY_MS                           100u
+
+/*
+ * Maximum number of steps that the run function executes in one call. The run
+ * function continues with the next step directly as long as no step has to wait
+ * for the bus. A value of 1 gives one step per call.
+ */
+#define SSD1306_RUN_STEP_BUDGET                             8u
+
+/*
+ * Maximum number of graphics data bytes that are sent in one call of the run
+ * function. Larger transfers are split in chunks that are sent in consecutive
+ * calls, and other users of the bus can get a time slot between the chunks. A
+ * chunk keeps the I2C bus busy for about SSD1306_DATA_CHUNK_SIZE/I2C_BYTES_PER_TICK
+ * ticks.
+ */
+#define SSD1306_DATA_CHUNK_SIZE                             32u
+
+/*
+ * Number of times a failed transfer is sent again before the operation fails.
+ * The driver waits SSD1306_RETRY_BACKOFF runs before the first retry, and the
+ * wait is doubled for each following retry.
+ */
+#define SSD1306_RETRY_LIMIT                                 3u
+#define SSD1306_RETRY_BACKOFF                               1u
+
+/*
+ * Keep a copy of the display RAM (GDDRAM) in the driver and only send the data
+ * that differs from it. Each run of changed data is written at its own position
+ * in the display RAM. Uses SSD1306_WIDTH * SSD1306_GDDRAM_PAGES bytes
+ * (plus 1/8 of that) of RAM for each display, and displays that are wider than
+ * SSD1306_WIDTH can not be added. Set to 1 to enable.
+ */
+#ifndef SSD1306_GDDRAM_SHADOW
+#define SSD1306_GDDRAM_SHADOW                               0u
+#endif
+
 #endif  // SSD1306_CONFIG_H
@@ -0,0 +1,167 @@
+/*
+ * Unit tests for the BitLoom flush planner.
+ *
+ * Copyright (c) 2021. BlueZephyr
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ *
+ */
+#include <CppUTest/CommandLineTestRunner.h>
+
+extern "C"
+{
+    #include "flush_planner.h"
+    #include "framebuffer.h"
+    #include "config/framebuffer_config.h"
+}
+
+/*
+ * Defines for the test cases. Cost of an area with one chunk of data.
+ */
+#define AREA_COST(bytes)        ((bytes) + FLUSH_COST_TRANSFER + FLUSH_COST_WINDOW)
+
+TEST_GROUP(flush_planner)
+{
+    struct framebuffer_area_t areas[FLUSH_PLANNER_MAX_AREAS];
+    uint8_t areaCount;
+
+    void setup() override
+    {
+        flush_planner_init();
+        framebuffer_init();
+        framebuffer_clearDirty();
+        areaCount = 0;
+    }
+
+    void teardown() override
+    {
+    }
+
+    void checkArea(const struct framebuffer_area_t &area,
+                   uint8_t xStart, uint8_t xEnd, uint8_t yStart, uint8_t yEnd)
+    {
+        CHECK_EQUAL(xStart, area.xStart);
+        CHECK_EQUAL(xEnd, area.xEnd);
+        CHECK_EQUAL(yStart, area.yStart);
+        CHECK_EQUAL(yEnd, area.yEnd);
+    }
+
+    void setColumn(uint8_t x, uint8_t firstPage, uint8_t lastPage)
+    {
+        for (uint8_t page=firstPage; page<=lastPage; page++)
+        {
+            framebuffer_setPixel(x, page * 8);
+        }
+    }
+};
+
+/********************************************************************
+ * TEST CASES
+ ********************************************************************/
+TEST(flush_planner, cost_of_an_area_is_the_data_a_transfer_and_a_window_change)
+{
+    struct framebuffer_area_t area = {10, 19, 2, 3};
+
+    CHECK_EQUAL(AREA_COST(20), flush_planner_getCost(&area, 1));
+}
+
+TEST(flush_planner, cost_includes_a_transfer_for_each_chunk)
+{
+    struct framebuffer_area_t area = {0, FRAMEBUFFER_X_PIXELS - 1, 0, 0};
+    uint16_t chunks = (FRAMEBUFFER_X_PIXELS + SSD1306_DATA_CHUNK_SIZE - 1) / SSD1306_DATA_CHUNK_SIZE;
+
+    CHECK_EQUAL(FRAMEBUFFER_X_PIXELS + chunks * FLUSH_COST_TRANSFER + FLUSH_COST_WINDOW,
+                flush_planner_getCost(&area, 1));
+}
+
+TEST(flush_planner, window_change_is_free_for_the_last_area_of_the_previous_plan)
+{
+    framebuffer_setPixel(5, 0);
+    flush_planner_plan(areas, &areaCount);
+    CHECK_EQUAL(1, areaCount);
+    CHECK_EQUAL(AREA_COST(1) - FLUSH_COST_WINDOW, flush_planner_getCost(areas, 1));
+}
+
+TEST(flush_planner, areas_far_apart_are_sent_separately)
+{
+    framebuffer_setPixel(0, 0);
+    framebuffer_setPixel(FRAMEBUFFER_X_PIXELS - 1, FRAMEBUFFER_Y_PIXELS - 1);
+    CHECK_EQUAL(flush_plan_dirty_areas, flush_planner_plan(areas, &areaCount));
+    CHECK_EQUAL(2, areaCount);
+    checkArea(areas[0], 0, 0, 0, 0);
+    checkArea(areas[1], FRAMEBUFFER_X_PIXELS - 1, FRAMEBUFFER_X_PIXELS - 1,
+              FRAMEBUFFER_Y_PIXELS / 8 - 1, FRAMEBUFFER_Y_PIXELS / 8 - 1);
+}
+
+TEST(flush_planner, areas_close_together_are_merged)
+{
+    // Two windows cost more than the two columns in between
+    framebuffer_setPixel(0, 0);
+    framebuffer_setPixel(3, 0);
+    CHECK_EQUAL(2, framebuffer_getDirtyAreas(areas));
+    CHECK_EQUAL(flush_plan_dirty_areas, flush_planner_plan(areas, &areaCount));
+    CHECK_EQUAL(1, areaCount);
+    checkArea(areas[0], 0, 3, 0, 0);
+}
+
+TEST(flush_planner, page_spans_are_chosen_for_a_staircase)
+{
+    // The dirty areas touch and are merged into the bounding box
+    for (uint8_t page=0; page<3; page++)
+    {
+        for (uint8_t x=0; x<12; x++)
+        {
+            framebuffer_setPixel(page * 10 + x, page * 8);
+        }
+    }
+    CHECK_EQUAL(flush_plan_page_spans, flush_planner_plan(areas, &areaCount));
+    CHECK_EQUAL(3, areaCount);
+    CHECK_EQUAL(3 * AREA_COST(12), flush_planner_getCost(areas, areaCount));
+}
+
+TEST(flush_planner, full_frame_is_the_only_area_after_the_init)
+{
+    framebuffer_init();
+    flush_planner_plan(areas, &areaCount);
+    CHECK_EQUAL(1, areaCount);
+    checkArea(areas[0], 0, FRAMEBUFFER_X_PIXELS - 1, 0, FRAMEBUFFER_Y_PIXELS / 8 - 1);
+}
+
+TEST(flush_planner, merged_area_does_not_overlap_the_other_areas)
+{
+    // Two small areas on page 3, and a column between them on pages 3-7. The
+    // merged area on page 3 covers the top of the column, which is clipped.
+    setColumn(0, 3, 3);
+    setColumn(1, 3, 3);
+    setColumn(8, 3, 3);
+    setColumn(9, 3, 3);
+    setColumn(4, 3, 7);
+    setColumn(5, 3, 7);
+    CHECK_EQUAL(3, framebuffer_getDirtyAreas(areas));
+
+    CHECK_EQUAL(2, flush_planner_getAreas(flush_plan_dirty_areas, areas));
+    checkArea(areas[0], 4, 5, 4, 7);
+    checkArea(areas[1], 0, 9, 3, 3);
+    CHECK_EQUAL(AREA_COST(10) + AREA_COST(8), flush_planner_getCost(areas, 2));
+}
+
+TEST(flush_planner, area_covered_by_the_merged_area_is_removed)
+{
+    // The pixels on pages 0 and 2 are merged, which covers the pixel between them
+    framebuffer_setPixel(0, 0);
+    framebuffer_setPixel(2, 8);
+    framebuffer_setPixel(4, 16);
+    CHECK_EQUAL(3, framebuffer_getDirtyAreas(areas));
+
+    CHECK_EQUAL(1, flush_planner_getAreas(flush_plan_dirty_areas, areas));
+    checkArea(areas[0], 0, 4, 0, 2);
+}
+
+/********************************************************************
+ * TEST RUNNER
+ ********************************************************************/
+int main(int ac, char** av)
+{
+    return CommandLineTestRunner::RunAllTests(ac, av);
+}
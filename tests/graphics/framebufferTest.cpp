@@ -0,0 +1,220 @@
+/*
+ * Unit tests for the BitLoom framebuffer library.
+ *
+ * Copyright (c) 2021. BlueZephyr
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ *
+ */
+#include <CppUTest/CommandLineTestRunner.h>
+
+extern "C"
+{
+    #include "framebuffer.h"
+    #include "config/framebuffer_config.h"
+}
+
+TEST_GROUP(framebuffer)
+{
+    struct framebuffer_area_t areas[FRAMEBUFFER_DIRTY_AREAS];
+
+    void setup() override
+    {
+        // The whole framebuffer is dirty after the init
+        framebuffer_init();
+        framebuffer_clearDirty();
+    }
+
+    void teardown() override
+    {
+    }
+
+    void checkArea(const struct framebuffer_area_t &area,
+                   uint8_t xStart, uint8_t xEnd, uint8_t yStart, uint8_t yEnd)
+    {
+        CHECK_EQUAL(xStart, area.xStart);
+        CHECK_EQUAL(xEnd, area.xEnd);
+        CHECK_EQUAL(yStart, area.yStart);
+        CHECK_EQUAL(yEnd, area.yEnd);
+    }
+};
+
+/********************************************************************
+ * TEST CASES
+ ********************************************************************/
+TEST(framebuffer, whole_framebuffer_is_dirty_after_the_init)
+{
+    framebuffer_init();
+    CHECK_TRUE(framebuffer_isDirty());
+    CHECK_EQUAL(1, framebuffer_getDirtyAreas(areas));
+    checkArea(areas[0], 0, FRAMEBUFFER_X_PIXELS - 1, 0, FRAMEBUFFER_Y_PIXELS / 8 - 1);
+}
+
+TEST(framebuffer, areas_far_apart_are_kept_separate)
+{
+    framebuffer_setPixel(0, 0);
+    framebuffer_setPixel(100, 40);
+    CHECK_TRUE(framebuffer_isDirty());
+    CHECK_EQUAL(2, framebuffer_getDirtyAreas(areas));
+    checkArea(areas[0], 0, 0, 0, 0);
+    checkArea(areas[1], 100, 100, 5, 5);
+}
+
+TEST(framebuffer, areas_that_touch_are_merged)
+{
+    // Next to each other on the same line and diagonally on the next line
+    framebuffer_setPixel(10, 0);
+    framebuffer_setPixel(11, 0);
+    framebuffer_setPixel(12, 8);
+    CHECK_EQUAL(1, framebuffer_getDirtyAreas(areas));
+    checkArea(areas[0], 10, 12, 0, 1);
+}
+
+TEST(framebuffer, area_that_joins_two_areas_merges_them)
+{
+    framebuffer_setPixel(10, 0);
+    framebuffer_setPixel(12, 0);
+    CHECK_EQUAL(2, framebuffer_getDirtyAreas(areas));
+    framebuffer_setPixel(11, 0);
+    CHECK_EQUAL(1, framebuffer_getDirtyAreas(areas));
+    checkArea(areas[0], 10, 12, 0, 0);
+}
+
+TEST(framebuffer, closest_areas_are_merged_when_there_are_too_many)
+{
+    for (uint8_t i=0; i<FRAMEBUFFER_DIRTY_AREAS; i++)
+    {
+        framebuffer_setPixel(i * 30, 0);
+    }
+    CHECK_EQUAL(FRAMEBUFFER_DIRTY_AREAS, framebuffer_getDirtyAreas(areas));
+
+    // The new area is merged with the closest area, the others are kept
+    framebuffer_setPixel((FRAMEBUFFER_DIRTY_AREAS - 1) * 30 + 10, 0);
+    CHECK_EQUAL(FRAMEBUFFER_DIRTY_AREAS, framebuffer_getDirtyAreas(areas));
+    for (uint8_t i=0; i<FRAMEBUFFER_DIRTY_AREAS - 1; i++)
+    {
+        checkArea(areas[i], i * 30, i * 30, 0, 0);
+    }
+    checkArea(areas[FRAMEBUFFER_DIRTY_AREAS - 1],
+              (FRAMEBUFFER_DIRTY_AREAS - 1) * 30, (FRAMEBUFFER_DIRTY_AREAS - 1) * 30 + 10, 0, 0);
+}
+
+TEST(framebuffer, dirty_areas_are_within_the_dirty_area)
+{
+    uint8_t xStart, xEnd, yStart, yEnd;
+
+    framebuffer_setPixel(5, 10);
+    framebuffer_setPixel(90, 60);
+    framebuffer_getDirtyArea(&xStart, &xEnd, &yStart, &yEnd);
+    CHECK_EQUAL(5, xStart);
+    CHECK_EQUAL(90, xEnd);
+    CHECK_EQUAL(1, yStart);
+    CHECK_EQUAL(7, yEnd);
+}
+
+TEST(framebuffer, areas_start_over_when_the_dirty_state_is_cleared)
+{
+    framebuffer_setPixel(0, 0);
+    framebuffer_setPixel(100, 40);
+    framebuffer_clearDirty();
+    CHECK_FALSE(framebuffer_isDirty());
+
+    framebuffer_setPixel(50, 20);
+    CHECK_EQUAL(1, framebuffer_getDirtyAreas(areas));
+    checkArea(areas[0], 50, 50, 2, 2);
+}
+
+TEST(framebuffer, modified_columns_are_kept_for_each_line)
+{
+    uint8_t xStart, xEnd;
+
+    // A staircase, 12 columns on each of the first three lines
+    for (uint8_t line=0; line<3; line++)
+    {
+        for (uint8_t x=0; x<12; x++)
+        {
+            framebuffer_setPixel(line * 10 + x, line * 8);
+        }
+    }
+    for (uint8_t line=0; line<3; line++)
+    {
+        CHECK_TRUE(framebuffer_getDirtySpan(line, &xStart, &xEnd));
+        CHECK_EQUAL(line * 10, xStart);
+        CHECK_EQUAL(line * 10 + 11, xEnd);
+    }
+    CHECK_FALSE(framebuffer_getDirtySpan(3, &xStart, &xEnd));
+    CHECK_FALSE(framebuffer_getDirtySpan(FRAMEBUFFER_Y_PIXELS / 8, &xStart, &xEnd));
+}
+
+TEST(framebuffer, span_of_a_line_covers_all_modifications_on_it)
+{
+    const uint8_t object[] = {0xFF, 0xFF, 0xFF};
+    uint8_t xStart, xEnd;
+
+    // The object covers lines 1 and 2
+    framebuffer_setPixel(40, 8);
+    framebuffer_blit(10, 12, 3, 8, object);
+    CHECK_TRUE(framebuffer_getDirtySpan(1, &xStart, &xEnd));
+    CHECK_EQUAL(10, xStart);
+    CHECK_EQUAL(40, xEnd);
+    CHECK_TRUE(framebuffer_getDirtySpan(2, &xStart, &xEnd));
+    CHECK_EQUAL(10, xStart);
+    CHECK_EQUAL(12, xEnd);
+}
+
+TEST(framebuffer, all_columns_are_modified_after_the_init)
+{
+    uint8_t xStart, xEnd;
+
+    framebuffer_init();
+    for (uint8_t line=0; line<FRAMEBUFFER_Y_PIXELS / 8; line++)
+    {
+        CHECK_TRUE(framebuffer_getDirtySpan(line, &xStart, &xEnd));
+        CHECK_EQUAL(0, xStart);
+        CHECK_EQUAL(FRAMEBUFFER_X_PIXELS - 1, xEnd);
+    }
+}
+
+TEST(framebuffer, drawing_on_a_locked_line_is_rejected)
+{
+    const uint8_t object[] = {0xFF, 0xFF};
+
+    framebuffer_lock();
+    CHECK_FALSE(framebuffer_setPixel(10, 10));
+    CHECK_FALSE(framebuffer_blit(20, 8, 2, 8, object));
+    CHECK_EQUAL(0, framebuffer_getPixel(10, 10));
+    CHECK_EQUAL(0, framebuffer_getPixel(20, 8));
+    CHECK_FALSE(framebuffer_isDirty());
+
+    framebuffer_unlock();
+    CHECK_TRUE(framebuffer_setPixel(10, 10));
+    framebuffer_lock();
+    CHECK_FALSE(framebuffer_clearPixel(10, 10));
+    CHECK_TRUE(framebuffer_getPixel(10, 10));
+}
+
+TEST(framebuffer, unlocked_lines_can_be_drawn_on)
+{
+    const uint8_t object[] = {0xFF, 0xFF};
+
+    framebuffer_lock();
+    framebuffer_unlockLines(1u << 1);
+    CHECK_TRUE(framebuffer_isLocked());
+    CHECK_FALSE(framebuffer_isLineLocked(1));
+    CHECK_TRUE(framebuffer_isLineLocked(2));
+    CHECK_TRUE(framebuffer_setPixel(10, 10));
+    CHECK_TRUE(framebuffer_getPixel(10, 10));
+
+    // The object covers lines 1 and 2
+    CHECK_FALSE(framebuffer_blit(20, 12, 2, 8, object));
+    CHECK_EQUAL(0, framebuffer_getPixel(20, 12));
+}
+
+/********************************************************************
+ * TEST RUNNER
+ ********************************************************************/
+int main(int ac, char** av)
+{
+    return CommandLineTestRunner::RunAllTests(ac, av);
+}
@@ -0,0 +1,142 @@
+/*
+ * Unit tests for the BitLoom graphics library with a double buffered
+ * framebuffer (FRAMEBUFFER_DOUBLE_BUFFER).
+ *
+ * Copyright (c) 2021. BlueZephyr
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ *
+ */
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTestExt/MockSupport.h>
+
+extern "C"
+{
+    #include "graphics.h"
+    #include "framebuffer.h"
+    #include "ssd1306.h"
+    #include "config/framebuffer_config.h"
+    #include "ssd1306_mock.h"
+}
+
+/*
+ * Defines for the test cases.
+ */
+#define GRAPHICS_TASK_ID                                     2
+#define PAGES                                                (FRAMEBUFFER_Y_PIXELS / 8)
+
+static const uint8_t clearedFrame[FRAMEBUFFER_SIZE] = {0};
+
+TEST_GROUP(graphics_double_buffer)
+{
+    void setup() override
+    {
+        ssd1306_mock_init(SSD1306_MAX_DISPLAYS);
+        framebuffer_init();
+        graphics_init(GRAPHICS_TASK_ID);
+
+        // The display is initialized and the cleared framebuffer is sent
+        mock().expectOneCall("ssd1306_initDisplayOn").withParameter("display", 0);
+        mock().expectOneCall("ssd1306_setMemoryAddressingModeOn").
+                withParameter("display", 0).
+                withParameter("mode", ssd1306_addressing_horizontal);
+        expectArea(0, FRAMEBUFFER_X_PIXELS - 1, 0, PAGES - 1, clearedFrame, sizeof(clearedFrame));
+        runGraphics(3);
+        mock().checkExpectations();
+    }
+
+    void teardown() override
+    {
+        mock().checkExpectations();
+        mock().clear();
+    }
+
+    void expectArea(uint8_t colStart, uint8_t colEnd, uint8_t pageStart, uint8_t pageEnd,
+                    const uint8_t *data, uint16_t length)
+    {
+        mock().expectOneCall("ssd1306_setColumnAddressOn").
+                withParameter("display", 0).
+                withParameter("startAddress", colStart).
+                withParameter("endAddress", colEnd);
+        mock().expectOneCall("ssd1306_setPageAddressOn").
+                withParameter("display", 0).
+                withParameter("startAddress", pageStart).
+                withParameter("endAddress", pageEnd);
+        mock().expectOneCall("ssd1306_sendGraphicsSpansOn").
+                withParameter("display", 0).
+                withMemoryBufferParameter("data", data, length);
+    }
+
+    // Run the graphics task. The requests to the display are done after each run.
+    void runGraphics(int runs)
+    {
+        for (int i=0; i<runs; i++)
+        {
+            graphics_run();
+            ssd1306_mock_completeOperations(ssd1306_result_ok);
+        }
+    }
+};
+
+/********************************************************************
+ * TEST CASES
+ ********************************************************************/
+TEST(graphics_double_buffer, only_the_modified_columns_are_copied_to_the_front_buffer)
+{
+    // The first pixel is not part of a dirty area when the copy is made
+    framebuffer_setPixel(5, 0);
+    framebuffer_clearDirty();
+    framebuffer_setPixel(100, 40);
+    framebuffer_copyToFront();
+    CHECK_EQUAL(0x00, *framebuffer_getSegments(5, 0));
+    CHECK_EQUAL(0x01, *framebuffer_getSegments(100, 5));
+}
+
+TEST(graphics_double_buffer, drawing_during_a_send_does_not_change_the_sent_data)
+{
+    const uint8_t data[] = {0x01};
+    const uint8_t *sentSegment = framebuffer_getSegments(0, 0);
+
+    framebuffer_setPixel(0, 0);
+    expectArea(0, 0, 0, 0, data, sizeof(data));
+    graphics_show();
+    graphics_run();
+    CHECK_FALSE(framebuffer_isLocked());
+
+    // The frame is being sent from the front buffer
+    CHECK_TRUE(framebuffer_setPixel(0, 1));
+    CHECK_TRUE(framebuffer_getPixel(0, 1));
+    CHECK_EQUAL(0x01, *sentSegment);
+    ssd1306_mock_completeOperations(ssd1306_result_ok);
+    runGraphics(2);
+}
+
+TEST(graphics_double_buffer, show_request_during_a_send_is_handled_afterwards)
+{
+    const uint8_t data[] = {0x01};
+    const uint8_t nextData[] = {0x03};
+
+    framebuffer_setPixel(0, 0);
+    expectArea(0, 0, 0, 0, data, sizeof(data));
+    graphics_show();
+    graphics_run();
+
+    // The next frame is requested while the first one is sent
+    framebuffer_setPixel(0, 1);
+    graphics_show();
+    ssd1306_mock_completeOperations(ssd1306_result_ok);
+    mock().checkExpectations();
+
+    expectArea(0, 0, 0, 0, nextData, sizeof(nextData));
+    runGraphics(3);
+    CHECK_FALSE(framebuffer_isDirty());
+}
+
+/********************************************************************
+ * TEST RUNNER
+ ********************************************************************/
+int main(int ac, char** av)
+{
+    return CommandLineTestRunner::RunAllTests(ac, av);
+}
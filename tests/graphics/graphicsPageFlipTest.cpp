@@ -0,0 +1,165 @@
+/*
+ * Unit tests for the BitLoom graphics library with page flipping
+ * (GRAPHICS_PAGE_FLIP) on a 128x32 panel.
+ *
+ * Copyright (c) 2021. BlueZephyr
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ *
+ */
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTestExt/MockSupport.h>
+
+extern "C"
+{
+    #include "graphics.h"
+    #include "framebuffer.h"
+    #include "ssd1306.h"
+    #include "config/framebuffer_config.h"
+    #include "ssd1306_mock.h"
+}
+
+/*
+ * Defines for the test cases. The display RAM holds two frames of 4 pages.
+ */
+#define GRAPHICS_TASK_ID                                     2
+#define PAGES                                                4u
+
+static const uint8_t clearedFrame[FRAMEBUFFER_SIZE] = {0};
+
+TEST_GROUP(graphics_page_flip)
+{
+    void setup() override
+    {
+        ssd1306_mock_init(GRAPHICS_PANELS);
+        framebuffer_init();
+        graphics_init(GRAPHICS_TASK_ID);
+
+        // The cleared framebuffer is sent in full to the lower half, which is
+        // then shown
+        mock().expectOneCall("ssd1306_initDisplayOn").withParameter("display", 0);
+        mock().expectOneCall("ssd1306_setMemoryAddressingModeOn").
+                withParameter("display", 0).
+                withParameter("mode", ssd1306_addressing_horizontal);
+        expectArea(0, FRAMEBUFFER_X_PIXELS - 1, PAGES, 2 * PAGES - 1, clearedFrame, sizeof(clearedFrame));
+        expectStartLine(PAGES * 8);
+        runGraphics(4);
+        mock().checkExpectations();
+    }
+
+    void teardown() override
+    {
+        mock().checkExpectations();
+        mock().clear();
+    }
+
+    void expectArea(uint8_t colStart, uint8_t colEnd, uint8_t pageStart, uint8_t pageEnd,
+                    const uint8_t *data, uint16_t length)
+    {
+        mock().expectOneCall("ssd1306_setColumnAddressOn").
+                withParameter("display", 0).
+                withParameter("startAddress", colStart).
+                withParameter("endAddress", colEnd);
+        mock().expectOneCall("ssd1306_setPageAddressOn").
+                withParameter("display", 0).
+                withParameter("startAddress", pageStart).
+                withParameter("endAddress", pageEnd);
+        mock().expectOneCall("ssd1306_sendGraphicsSpansOn").
+                withParameter("display", 0).
+                withMemoryBufferParameter("data", data, length);
+    }
+
+    void expectStartLine(uint8_t line)
+    {
+        mock().expectOneCall("ssd1306_setDisplayStartLineOn").
+                withParameter("display", 0).
+                withParameter("line", line);
+    }
+
+    // Run the graphics task. The requests to the display are done after each run.
+    void runGraphics(int runs)
+    {
+        for (int i=0; i<runs; i++)
+        {
+            graphics_run();
+            ssd1306_mock_completeOperations(ssd1306_result_ok);
+        }
+    }
+
+    // Send the first frame, which is sent in full to the upper half
+    void sendFirstFrame()
+    {
+        uint8_t frame[FRAMEBUFFER_SIZE] = {0x01};
+
+        framebuffer_setPixel(0, 0);
+        expectArea(0, FRAMEBUFFER_X_PIXELS - 1, 0, PAGES - 1, frame, sizeof(frame));
+        expectStartLine(0);
+        graphics_show();
+        runGraphics(3);
+        mock().checkExpectations();
+    }
+};
+
+/********************************************************************
+ * TEST CASES
+ ********************************************************************/
+TEST(graphics_page_flip, first_frame_is_sent_in_full_to_each_half)
+{
+    sendFirstFrame();
+}
+
+TEST(graphics_page_flip, areas_of_the_previous_frame_are_sent_as_well)
+{
+    const uint8_t pixel[] = {0x01};
+    const uint8_t secondPixel[] = {0x10};
+
+    sendFirstFrame();
+
+    // The lower half is two frames behind. It gets the pixel of the previous
+    // frame and the new pixel.
+    framebuffer_setPixel(100, 20);
+    expectArea(100, 100, PAGES + 2, PAGES + 2, secondPixel, sizeof(secondPixel));
+    expectArea(0, 0, PAGES, PAGES, pixel, sizeof(pixel));
+    expectStartLine(PAGES * 8);
+    graphics_show();
+    runGraphics(4);
+    mock().checkExpectations();
+
+    // The upper half gets the new pixel and the pixel of the previous frame
+    framebuffer_clearPixel(0, 0);
+    expectArea(0, 0, 0, 0, clearedFrame, 1);
+    expectArea(100, 100, 2, 2, secondPixel, sizeof(secondPixel));
+    expectStartLine(0);
+    graphics_show();
+    runGraphics(4);
+}
+
+TEST(graphics_page_flip, start_line_is_changed_when_the_data_has_been_sent)
+{
+    uint8_t frame[FRAMEBUFFER_SIZE] = {0x01};
+
+    framebuffer_setPixel(0, 0);
+    expectArea(0, FRAMEBUFFER_X_PIXELS - 1, 0, PAGES - 1, frame, sizeof(frame));
+    expectStartLine(0);
+    graphics_show();
+
+    // The data is still being sent
+    graphics_run();
+    graphics_run();
+    graphics_run();
+    CHECK_EQUAL(1, mock().expectedCallsLeft());
+
+    // The hidden half is shown when the data has been sent
+    ssd1306_mock_completeOperations(ssd1306_result_ok);
+    graphics_run();
+    CHECK_EQUAL(0, mock().expectedCallsLeft());
+}
+
+/********************************************************************
+ * TEST RUNNER
+ ********************************************************************/
+int main(int ac, char** av)
+{
+    return CommandLineTestRunner::RunAllTests(ac, av);
+}
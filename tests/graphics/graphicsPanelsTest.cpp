@@ -0,0 +1,132 @@
+/*
+ * Unit tests for the BitLoom graphics library with a framebuffer that spans
+ * two 128x64 panels (GRAPHICS_PANELS).
+ *
+ * Copyright (c) 2021. BlueZephyr
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ *
+ */
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTestExt/MockSupport.h>
+
+extern "C"
+{
+    #include "graphics.h"
+    #include "framebuffer.h"
+    #include "ssd1306.h"
+    #include "config/framebuffer_config.h"
+    #include "ssd1306_mock.h"
+}
+
+/*
+ * Defines for the test cases.
+ */
+#define GRAPHICS_TASK_ID                                     2
+#define PAGES                                                (FRAMEBUFFER_Y_PIXELS / 8)
+#define PANEL_WIDTH                                          SSD1306_WIDTH
+
+static const uint8_t clearedPanel[PANEL_WIDTH * PAGES] = {0};
+
+TEST_GROUP(graphics_panels)
+{
+    void setup() override
+    {
+        ssd1306_mock_init(GRAPHICS_PANELS);
+        framebuffer_init();
+        graphics_init(GRAPHICS_TASK_ID);
+
+        // Both displays are initialized and get their half of the cleared framebuffer
+        for (uint8_t display=0; display<GRAPHICS_PANELS; display++)
+        {
+            mock().expectOneCall("ssd1306_initDisplayOn").withParameter("display", display);
+            mock().expectOneCall("ssd1306_setMemoryAddressingModeOn").
+                    withParameter("display", display).
+                    withParameter("mode", ssd1306_addressing_horizontal);
+            expectArea(display, 0, PANEL_WIDTH - 1, 0, PAGES - 1, clearedPanel, sizeof(clearedPanel));
+        }
+        runGraphics(3);
+        mock().checkExpectations();
+    }
+
+    void teardown() override
+    {
+        mock().checkExpectations();
+        mock().clear();
+    }
+
+    void expectArea(uint8_t display, uint8_t colStart, uint8_t colEnd, uint8_t pageStart, uint8_t pageEnd,
+                    const uint8_t *data, uint16_t length)
+    {
+        mock().expectOneCall("ssd1306_setColumnAddressOn").
+                withParameter("display", display).
+                withParameter("startAddress", colStart).
+                withParameter("endAddress", colEnd);
+        mock().expectOneCall("ssd1306_setPageAddressOn").
+                withParameter("display", display).
+                withParameter("startAddress", pageStart).
+                withParameter("endAddress", pageEnd);
+        mock().expectOneCall("ssd1306_sendGraphicsSpansOn").
+                withParameter("display", display).
+                withMemoryBufferParameter("data", data, length);
+    }
+
+    // Run the graphics task. The requests to the displays are done after each run.
+    void runGraphics(int runs)
+    {
+        for (int i=0; i<runs; i++)
+        {
+            graphics_run();
+            ssd1306_mock_completeOperations(ssd1306_result_ok);
+        }
+    }
+};
+
+/********************************************************************
+ * TEST CASES
+ ********************************************************************/
+TEST(graphics_panels, area_on_the_left_panel_is_sent_to_display_0_only)
+{
+    const uint8_t data[] = {0x02, 0x02};
+
+    framebuffer_setPixel(20, 9);
+    framebuffer_setPixel(21, 9);
+    expectArea(0, 20, 21, 1, 1, data, sizeof(data));
+    graphics_show();
+    runGraphics(2);
+}
+
+TEST(graphics_panels, area_on_the_right_panel_is_sent_to_display_1_only)
+{
+    const uint8_t data[] = {0x80};
+
+    framebuffer_setPixel(200, 63);
+    expectArea(1, 200 - PANEL_WIDTH, 200 - PANEL_WIDTH, PAGES - 1, PAGES - 1, data, sizeof(data));
+    graphics_show();
+    runGraphics(2);
+}
+
+TEST(graphics_panels, area_across_the_panels_is_split_at_the_panel_edge)
+{
+    const uint8_t left[] = {0x01, 0x01};
+    const uint8_t right[] = {0x01, 0x01, 0x01};
+
+    for (uint8_t x=PANEL_WIDTH - 2; x<=PANEL_WIDTH + 2; x++)
+    {
+        framebuffer_setPixel(x, 0);
+    }
+    expectArea(0, PANEL_WIDTH - 2, PANEL_WIDTH - 1, 0, 0, left, sizeof(left));
+    expectArea(1, 0, 2, 0, 0, right, sizeof(right));
+    graphics_show();
+    runGraphics(2);
+    CHECK_FALSE(framebuffer_isLocked());
+}
+
+/********************************************************************
+ * TEST RUNNER
+ ********************************************************************/
+int main(int ac, char** av)
+{
+    return CommandLineTestRunner::RunAllTests(ac, av);
+}
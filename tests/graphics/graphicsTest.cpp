@@ -0,0 +1,215 @@
+/*
+ * Unit tests for the BitLoom graphics library.
+ *
+ * Copyright (c) 2021. BlueZephyr
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ *
+ */
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTestExt/MockSupport.h>
+
+extern "C"
+{
+    #include "graphics.h"
+    #include "framebuffer.h"
+    #include "ssd1306.h"
+    #include "config/framebuffer_config.h"
+    #include "ssd1306_mock.h"
+}
+
+/*
+ * Defines for the test cases.
+ */
+#define GRAPHICS_TASK_ID                                     2
+#define PAGES                                                (FRAMEBUFFER_Y_PIXELS / 8)
+
+static const uint8_t clearedFrame[FRAMEBUFFER_SIZE] = {0};
+
+TEST_GROUP(graphics)
+{
+    void setup() override
+    {
+        ssd1306_mock_init(SSD1306_MAX_DISPLAYS);
+        framebuffer_init();
+        graphics_init(GRAPHICS_TASK_ID);
+
+        // The display is initialized and the cleared framebuffer is sent
+        mock().expectOneCall("ssd1306_initDisplayOn").withParameter("display", 0);
+        mock().expectOneCall("ssd1306_setMemoryAddressingModeOn").
+                withParameter("display", 0).
+                withParameter("mode", ssd1306_addressing_horizontal);
+        expectArea(0, FRAMEBUFFER_X_PIXELS - 1, 0, PAGES - 1, clearedFrame, sizeof(clearedFrame));
+        runGraphics(3);
+        mock().checkExpectations();
+    }
+
+    void teardown() override
+    {
+        mock().checkExpectations();
+        mock().clear();
+    }
+
+    void expectArea(uint8_t colStart, uint8_t colEnd, uint8_t pageStart, uint8_t pageEnd,
+                    const uint8_t *data, uint16_t length)
+    {
+        mock().expectOneCall("ssd1306_setColumnAddressOn").
+                withParameter("display", 0).
+                withParameter("startAddress", colStart).
+                withParameter("endAddress", colEnd);
+        mock().expectOneCall("ssd1306_setPageAddressOn").
+                withParameter("display", 0).
+                withParameter("startAddress", pageStart).
+                withParameter("endAddress", pageEnd);
+        mock().expectOneCall("ssd1306_sendGraphicsSpansOn").
+                withParameter("display", 0).
+                withMemoryBufferParameter("data", data, length);
+    }
+
+    // Run the graphics task. The requests to the display are done after each run.
+    void runGraphics(int runs)
+    {
+        for (int i=0; i<runs; i++)
+        {
+            graphics_run();
+            ssd1306_mock_completeOperations(ssd1306_result_ok);
+        }
+    }
+};
+
+/********************************************************************
+ * TEST CASES
+ ********************************************************************/
+TEST(graphics, only_the_dirty_rectangle_is_sent)
+{
+    // Line of three pixels on page 0 (bit 3) and on page 1 (bit 4)
+    const uint8_t data[] = {0x08, 0x08, 0x08, 0x10, 0x10, 0x10};
+
+    for (uint8_t x=10; x<=12; x++)
+    {
+        framebuffer_setPixel(x, 3);
+        framebuffer_setPixel(x, 12);
+    }
+    expectArea(10, 12, 0, 1, data, sizeof(data));
+    graphics_show();
+    runGraphics(2);
+    CHECK_FALSE(framebuffer_isLocked());
+}
+
+TEST(graphics, modified_columns_of_each_page_are_sent)
+{
+    // A staircase, 12 columns on each of the first three pages. The bounding
+    // box (and the merged dirty area) would be 32 columns on three pages.
+    const uint8_t data[] = {0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01};
+
+    for (uint8_t page=0; page<3; page++)
+    {
+        for (uint8_t x=0; x<12; x++)
+        {
+            framebuffer_setPixel(page * 10 + x, page * 8);
+        }
+        expectArea(page * 10, page * 10 + 11, page, page, data, sizeof(data));
+    }
+    graphics_show();
+    runGraphics(4);
+    CHECK_FALSE(framebuffer_isLocked());
+}
+
+TEST(graphics, nothing_is_sent_if_the_framebuffer_is_not_modified)
+{
+    graphics_show();
+    runGraphics(2);
+    CHECK_FALSE(framebuffer_isLocked());
+}
+
+TEST(graphics, framebuffer_is_unlocked_when_the_data_has_been_sent)
+{
+    const uint8_t data[] = {0x01};
+
+    framebuffer_setPixel(0, 0);
+    expectArea(0, 0, 0, 0, data, sizeof(data));
+    graphics_show();
+    CHECK_TRUE(framebuffer_isLocked());
+    graphics_run();
+    CHECK_TRUE(framebuffer_isLineLocked(0));
+    ssd1306_mock_completeOperations(ssd1306_result_ok);
+    graphics_run();
+    CHECK_FALSE(framebuffer_isLocked());
+}
+
+TEST(graphics, lines_are_unlocked_as_the_frame_is_sent)
+{
+    const uint8_t data[] = {0x01};
+
+    // Two areas far apart, on page 0 and page 5
+    framebuffer_setPixel(0, 0);
+    framebuffer_setPixel(100, 40);
+    expectArea(0, 0, 0, 0, data, sizeof(data));
+    expectArea(100, 100, 5, 5, data, sizeof(data));
+    graphics_show();
+    CHECK_FALSE(framebuffer_setPixel(50, 24));
+
+    // The lines outside the frame are unlocked when the first area is sent
+    graphics_run();
+    CHECK_TRUE(framebuffer_setPixel(50, 24));
+    CHECK_FALSE(framebuffer_setPixel(1, 0));
+    CHECK_FALSE(framebuffer_setPixel(101, 40));
+    CHECK_EQUAL(0, framebuffer_getPixel(1, 0));
+
+    // The line of the first area is unlocked when the second area is sent
+    ssd1306_mock_completeOperations(ssd1306_result_ok);
+    graphics_run();
+    CHECK_TRUE(framebuffer_setPixel(1, 0));
+    CHECK_FALSE(framebuffer_setPixel(101, 40));
+
+    ssd1306_mock_completeOperations(ssd1306_result_ok);
+    graphics_run();
+    CHECK_FALSE(framebuffer_isLocked());
+    CHECK_TRUE(framebuffer_setPixel(101, 40));
+}
+
+TEST(graphics, lines_of_a_full_frame_are_unlocked_as_the_display_receives_them)
+{
+    uint8_t frame[FRAMEBUFFER_SIZE] = {0};
+
+    // The whole framebuffer is dirty after the init
+    framebuffer_init();
+    framebuffer_setPixel(0, 0);
+    frame[0] = 0x01;
+    expectArea(0, FRAMEBUFFER_X_PIXELS - 1, 0, PAGES - 1, frame, sizeof(frame));
+    graphics_show();
+    graphics_run();
+    CHECK_TRUE(framebuffer_isLineLocked(0));
+
+    // The display has received the first page
+    ssd1306_mock_setDataProgress(0, FRAMEBUFFER_X_PIXELS);
+    graphics_run();
+    CHECK_TRUE(framebuffer_setPixel(1, 0));
+    CHECK_FALSE(framebuffer_setPixel(1, 8));
+    CHECK_TRUE(framebuffer_isLineLocked(PAGES - 1));
+
+    ssd1306_mock_completeOperations(ssd1306_result_ok);
+    graphics_run();
+    CHECK_FALSE(framebuffer_isLocked());
+}
+
+TEST(graphics, display_selected_by_the_application_is_kept)
+{
+    const uint8_t data[] = {0x01};
+
+    framebuffer_setPixel(0, 0);
+    expectArea(0, 0, 0, 0, data, sizeof(data));
+    CHECK_TRUE(ssd1306_selectDisplay(1));
+    graphics_show();
+    runGraphics(2);
+    CHECK_EQUAL(1, ssd1306_getSelectedDisplay());
+}
+
+/********************************************************************
+ * TEST RUNNER
+ ********************************************************************/
+int main(int ac, char** av)
+{
+    return CommandLineTestRunner::RunAllTests(ac, av);
+}
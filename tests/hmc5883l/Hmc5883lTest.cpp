@@ -14,6 +14,7 @@
 extern "C"
 {
     #include "hmc5883l.h"
+    #include "i2c_arbiter.h"
 }
 
 #define HMC5883L_ADDRESS        0x3c
@@ -45,6 +46,7 @@ TEST_GROUP(hmc5883l)
     void setup() override
     {
         hmcOpResult = hmc_operation_ok;
+        i2c_arbiter_init();
         hmc_init(0);
     }
 
@@ -0,0 +1,190 @@
+/*
+ * Unit tests for the I2C bus arbiter.
+ *
+ * Copyright (c) 2021. BlueZephyr
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ *
+ */
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTestExt/MockSupport.h>
+
+extern "C"
+{
+    #include "i2c_arbiter.h"
+    #include "config/i2c_arbiter_config.h"
+    #include "hal/i2c.h"
+    #include "i2c_mock.h"
+}
+
+/*
+ * Defines for the test cases.
+ */
+#define DISPLAY_ADDRESS         0x3c
+#define SENSOR_ADDRESS          0x1e
+#define LOW_PRIORITY            1
+#define HIGH_PRIORITY           2
+
+
+TEST_GROUP(i2c_arbiter)
+{
+    uint8_t displayClient;
+    uint8_t sensorClient;
+    enum i2c_op_result_t displayResult;
+    enum i2c_op_result_t sensorResult;
+    uint8_t buffer[6];
+
+    void setup() override
+    {
+        i2c_arbiter_init();
+        displayClient = i2c_arbiter_addClient(LOW_PRIORITY);
+        sensorClient = i2c_arbiter_addClient(HIGH_PRIORITY);
+        displayResult = i2c_operation_ok;
+        sensorResult = i2c_operation_ok;
+    }
+
+    void teardown() override
+    {
+        mock().checkExpectations();
+        mock().clear();
+    }
+
+    void expectTransmit(uint8_t address, enum i2c_op_result_t *result)
+    {
+        *result = i2c_operation_processing;
+        mock().expectOneCall("i2c_masterTransmitRegister").
+                withParameter("address", address).
+                withOutputParameterReturning("result", result, sizeof(*result)).
+                ignoreOtherParameters().
+                andReturnValue(i2c_request_ok);
+    }
+
+    enum i2c_request_t displayRequest()
+    {
+        return i2c_arbiter_transmitRegister(displayClient, DISPLAY_ADDRESS, 0x40, buffer, 1, &displayResult);
+    }
+
+    enum i2c_request_t sensorRequest()
+    {
+        return i2c_arbiter_readRegister(sensorClient, SENSOR_ADDRESS, 0x03, buffer, 6, &sensorResult);
+    }
+};
+
+TEST(i2c_arbiter, request_is_forwarded_when_bus_is_free)
+{
+    expectTransmit(DISPLAY_ADDRESS, &displayResult);
+    CHECK_EQUAL(i2c_request_ok, displayRequest());
+}
+
+TEST(i2c_arbiter, request_is_rejected_while_other_operation_is_processing)
+{
+    expectTransmit(DISPLAY_ADDRESS, &displayResult);
+    CHECK_EQUAL(i2c_request_ok, displayRequest());
+
+    // No call to the I2C driver is expected for the sensor request
+    CHECK_EQUAL(i2c_request_busy, sensorRequest());
+}
+
+TEST(i2c_arbiter, waiting_client_with_higher_priority_gets_the_bus_first)
+{
+    expectTransmit(DISPLAY_ADDRESS, &displayResult);
+    CHECK_EQUAL(i2c_request_ok, displayRequest());
+    CHECK_EQUAL(i2c_request_busy, sensorRequest());
+    i2c_mock_updateI2cOpResult(i2c_operation_ok);
+
+    // The display must not get the bus since the sensor has a reservation
+    CHECK_EQUAL(i2c_request_busy, displayRequest());
+
+    mock().expectOneCall("i2c_read_register").
+            withParameter("address", SENSOR_ADDRESS).
+            ignoreOtherParameters().
+            andReturnValue(i2c_request_ok);
+    CHECK_EQUAL(i2c_request_ok, sensorRequest());
+}
+
+TEST(i2c_arbiter, waiting_client_with_lower_priority_gets_the_bus_when_latency_bound_is_exceeded)
+{
+    expectTransmit(SENSOR_ADDRESS, &sensorResult);
+    CHECK_EQUAL(i2c_request_ok, i2c_arbiter_transmitRegister(sensorClient, SENSOR_ADDRESS, 0x00, buffer, 1, &sensorResult));
+    for (uint8_t i=0; i<I2C_ARBITER_LATENCY_BOUND; i++)
+    {
+        CHECK_EQUAL(i2c_request_busy, displayRequest());
+    }
+    sensorResult = i2c_operation_ok;
+
+    // The sensor has waited once but the display has exceeded the latency bound
+    CHECK_EQUAL(i2c_request_busy, sensorRequest());
+    expectTransmit(DISPLAY_ADDRESS, &displayResult);
+    CHECK_EQUAL(i2c_request_ok, displayRequest());
+}
+
+TEST(i2c_arbiter, request_from_unknown_client_is_forwarded)
+{
+    expectTransmit(DISPLAY_ADDRESS, &displayResult);
+    CHECK_EQUAL(i2c_request_ok, i2c_arbiter_transmitRegister(I2C_ARBITER_NO_CLIENT, DISPLAY_ADDRESS, 0x40,
+                                                             buffer, 1, &displayResult));
+}
+
+TEST(i2c_arbiter, no_more_clients_than_configured_can_be_added)
+{
+    for (uint8_t i=2; i<I2C_ARBITER_MAX_CLIENTS; i++)
+    {
+        CHECK(i2c_arbiter_addClient(LOW_PRIORITY) != I2C_ARBITER_NO_CLIENT);
+    }
+    CHECK_EQUAL(I2C_ARBITER_NO_CLIENT, i2c_arbiter_addClient(LOW_PRIORITY));
+}
+
+TEST(i2c_arbiter, request_from_unknown_client_waits_for_the_bus)
+{
+    expectTransmit(DISPLAY_ADDRESS, &displayResult);
+    CHECK_EQUAL(i2c_request_ok, displayRequest());
+    CHECK_EQUAL(i2c_request_busy, i2c_arbiter_transmitRegister(I2C_ARBITER_NO_CLIENT, SENSOR_ADDRESS, 0x00,
+                                                               buffer, 1, &sensorResult));
+}
+
+TEST(i2c_arbiter, removed_client_makes_room_for_a_new_client)
+{
+    for (uint8_t i=2; i<I2C_ARBITER_MAX_CLIENTS; i++)
+    {
+        CHECK(i2c_arbiter_addClient(LOW_PRIORITY) != I2C_ARBITER_NO_CLIENT);
+    }
+    i2c_arbiter_removeClient(displayClient);
+    CHECK_EQUAL(displayClient, i2c_arbiter_addClient(LOW_PRIORITY));
+}
+
+TEST(i2c_arbiter, cancelled_request_does_not_hold_back_other_clients)
+{
+    expectTransmit(DISPLAY_ADDRESS, &displayResult);
+    CHECK_EQUAL(i2c_request_ok, displayRequest());
+    CHECK_EQUAL(i2c_request_busy, sensorRequest());
+    i2c_mock_updateI2cOpResult(i2c_operation_ok);
+
+    // The sensor gives up the request
+    i2c_arbiter_cancel(sensorClient);
+    mock().expectOneCall("i2c_masterTransmitRegister").
+            withParameter("address", DISPLAY_ADDRESS).
+            ignoreOtherParameters().
+            andReturnValue(i2c_request_ok);
+    CHECK_EQUAL(i2c_request_ok, displayRequest());
+}
+
+TEST(i2c_arbiter, removed_client_does_not_hold_back_other_clients)
+{
+    expectTransmit(DISPLAY_ADDRESS, &displayResult);
+    CHECK_EQUAL(i2c_request_ok, displayRequest());
+    CHECK_EQUAL(i2c_request_busy, sensorRequest());
+    i2c_mock_updateI2cOpResult(i2c_operation_ok);
+
+    i2c_arbiter_removeClient(sensorClient);
+    mock().expectOneCall("i2c_masterTransmitRegister").
+            withParameter("address", DISPLAY_ADDRESS).
+            ignoreOtherParameters().
+            andReturnValue(i2c_request_ok);
+    CHECK_EQUAL(i2c_request_ok, displayRequest());
+}
+
+int main(int ac, char** av)
+{
+    return CommandLineTestRunner::RunAllTests(ac, av);
+}
@@ -0,0 +1,52 @@
+/*
+ * Implementation of the spi mock module for the unit tests.
+ * The module implements a mock task that can be controlled by the test cases
+ * to verify that the drivers call the correct spi operations and that they
+ * are called in the correct order.
+ *
+ * The implementation uses the CppUMock framework
+ *
+ * Copyright (c) 2021. BlueZephyr
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ *
+ */
+
+#include <CppUTestExt/MockSupport.h>
+
+extern "C"
+{
+    // This module mocks the following interface
+    #include "hal/spi.h"
+    #include "spi_mock.h"
+}
+
+static struct spi_mock_t
+{
+    enum spi_op_result_t *spiOpResult;
+} self;
+
+void spi_mock_updateSpiOpResult(enum spi_op_result_t spiOpResult)
+{
+    *self.spiOpResult = spiOpResult;
+}
+
+void spi_init (void)
+{
+    mock().actualCall("spi_init");
+}
+
+enum spi_request_t
+spi_masterTransmit(uint8_t device, const uint8_t *buffer, uint16_t length, enum spi_op_result_t *result)
+{
+    // Store the address to the result to be able to change it from the test case
+    self.spiOpResult = result;
+    return static_cast<spi_request_t>(mock()
+            .actualCall("spi_masterTransmit")
+            .withParameter("device", device)
+            .withMemoryBufferParameter("buffer", buffer, length)
+            .withParameter("length", length)
+            .withOutputParameter("result", result)
+            .returnUnsignedIntValue());
+}
@@ -0,0 +1,30 @@
+/*
+ * Implementation of the spi mock module for the unit tests.
+ * The module implements a mock task that can be controlled by the test cases
+ * to verify that the drivers call the correct spi operations and that they
+ * are called in the correct order.
+ *
+ * The implementation uses the CppUMock framework
+ *
+ * Copyright (c) 2021. BlueZephyr
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ *
+ */
+
+#ifndef BITLOOM_DRIVERS_SPI_MOCK_H
+#define BITLOOM_DRIVERS_SPI_MOCK_H
+
+#include "hal/spi.h"
+
+/*
+ * This function is used to update the result of the SPI operation.
+ * Needed since the result is stored in a memory address that is updated
+ * without being explicitly requested.
+ *
+ * Note that the function must not be called before the mock
+ */
+void spi_mock_updateSpiOpResult(enum spi_op_result_t spiOpResult);
+
+#endif //BITLOOM_DRIVERS_SPI_MOCK_H
@@ -0,0 +1,177 @@
+/*
+ * Implementation of the ssd1306 mock module for the unit tests.
+ * The module implements a mock of the SSD1306 driver that can be controlled by
+ * the test cases to verify that the graphics library makes the correct
+ * requests to the displays and that they are made in the correct order.
+ *
+ * The implementation uses the CppUMock framework
+ *
+ * Copyright (c) 2021. BlueZephyr
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ *
+ */
+
+#include <vector>
+#include <CppUTestExt/MockSupport.h>
+
+extern "C"
+{
+    // This module mocks the following interface
+    #include "ssd1306.h"
+    #include "ssd1306_mock.h"
+    #include "config/ssd1306_config.h"
+}
+
+static struct ssd1306_mock_t
+{
+    uint8_t displayCount;
+    uint8_t selectedDisplay;
+    uint16_t dataProgress[SSD1306_MAX_DISPLAYS];
+    std::vector<enum ssd1306_result_t *> pendingResults;
+} self;
+
+/*
+ * Store the result of an accepted request to be able to complete it from the
+ * test case. The request is accepted unless the test case sets a return value.
+ */
+static enum ssd1306_request_t accepted(MockActualCall &call, enum ssd1306_result_t *result)
+{
+    enum ssd1306_request_t request =
+            static_cast<ssd1306_request_t>(call.returnUnsignedIntValueOrDefault(ssd1306_request_ok));
+
+    if (request == ssd1306_request_ok)
+    {
+        *result = ssd1306_result_processing;
+        self.pendingResults.push_back(result);
+    }
+    return request;
+}
+
+void ssd1306_mock_init(uint8_t displayCount)
+{
+    self.displayCount = displayCount;
+    self.selectedDisplay = 0;
+    for (uint16_t &progress : self.dataProgress)
+    {
+        progress = 0;
+    }
+    self.pendingResults.clear();
+}
+
+void ssd1306_mock_setDataProgress(uint8_t display, uint16_t bytes)
+{
+    self.dataProgress[display] = bytes;
+}
+
+void ssd1306_mock_completeOperations(enum ssd1306_result_t result)
+{
+    for (enum ssd1306_result_t *pending : self.pendingResults)
+    {
+        *pending = result;
+    }
+    self.pendingResults.clear();
+}
+
+bool ssd1306_selectDisplay(uint8_t display)
+{
+    if (display >= self.displayCount)
+    {
+        return false;
+    }
+    self.selectedDisplay = display;
+    return true;
+}
+
+uint8_t ssd1306_getSelectedDisplay(void)
+{
+    return self.selectedDisplay;
+}
+
+/*
+ * Requests to a display that does not exist are rejected without a call, as in
+ * the driver.
+ */
+enum ssd1306_request_t ssd1306_initDisplayOn(uint8_t display, enum ssd1306_result_t *result)
+{
+    if (display >= self.displayCount)
+    {
+        return ssd1306_request_invalid;
+    }
+    return accepted(mock()
+            .actualCall("ssd1306_initDisplayOn")
+            .withParameter("display", display), result);
+}
+
+void ssd1306_setMemoryAddressingModeOn(uint8_t display, enum ssd1306_addressing_mode_t mode)
+{
+    if (display < self.displayCount)
+    {
+        mock().actualCall("ssd1306_setMemoryAddressingModeOn")
+                .withParameter("display", display)
+                .withParameter("mode", mode);
+    }
+}
+
+void ssd1306_setColumnAddressOn(uint8_t display, uint8_t startAddress, uint8_t endAddress)
+{
+    if (display < self.displayCount)
+    {
+        mock().actualCall("ssd1306_setColumnAddressOn")
+                .withParameter("display", display)
+                .withParameter("startAddress", startAddress)
+                .withParameter("endAddress", endAddress);
+    }
+}
+
+void ssd1306_setPageAddressOn(uint8_t display, uint8_t startAddress, uint8_t endAddress)
+{
+    if (display < self.displayCount)
+    {
+        mock().actualCall("ssd1306_setPageAddressOn")
+                .withParameter("display", display)
+                .withParameter("startAddress", startAddress)
+                .withParameter("endAddress", endAddress);
+    }
+}
+
+enum ssd1306_request_t ssd1306_setDisplayStartLineOn(uint8_t display, uint8_t line, enum ssd1306_result_t *result)
+{
+    if (display >= self.displayCount)
+    {
+        return ssd1306_request_invalid;
+    }
+    return accepted(mock()
+            .actualCall("ssd1306_setDisplayStartLineOn")
+            .withParameter("display", display)
+            .withParameter("line", line), result);
+}
+
+/*
+ * The data of the spans is checked as one buffer
+ */
+enum ssd1306_request_t ssd1306_sendGraphicsSpansOn(uint8_t display, const struct ssd1306_data_span_t *spans,
+                                                   uint8_t count, enum ssd1306_result_t *result)
+{
+    std::vector<uint8_t> data;
+
+    if (display >= self.displayCount)
+    {
+        return ssd1306_request_invalid;
+    }
+    self.dataProgress[display] = 0;
+    for (uint8_t i=0; i<count; i++)
+    {
+        data.insert(data.end(), spans[i].data, spans[i].data + spans[i].len);
+    }
+    return accepted(mock()
+            .actualCall("ssd1306_sendGraphicsSpansOn")
+            .withParameter("display", display)
+            .withMemoryBufferParameter("data", data.data(), data.size()), result);
+}
+
+uint16_t ssd1306_getDataProgressOn(uint8_t display)
+{
+    return (display < self.displayCount) ? self.dataProgress[display] : 0;
+}
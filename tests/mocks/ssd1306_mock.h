@@ -0,0 +1,39 @@
+/*
+ * Implementation of the ssd1306 mock module for the unit tests.
+ * The module implements a mock of the SSD1306 driver that can be controlled by
+ * the test cases to verify that the graphics library makes the correct
+ * requests to the displays and that they are made in the correct order.
+ *
+ * The implementation uses the CppUMock framework. The graphics library makes
+ * its requests with the functions that take the display as a parameter.
+ *
+ * Copyright (c) 2021. BlueZephyr
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ *
+ */
+
+#ifndef BITLOOM_DRIVERS_SSD1306_MOCK_H
+#define BITLOOM_DRIVERS_SSD1306_MOCK_H
+
+#include "ssd1306.h"
+
+/*
+ * Set the number of displays that requests can be made to. Resets the mock.
+ */
+void ssd1306_mock_init(uint8_t displayCount);
+
+/*
+ * The result of an accepted request is ssd1306_result_processing until this
+ * function is called. Sets the result of all requests in progress.
+ */
+void ssd1306_mock_completeOperations(enum ssd1306_result_t result);
+
+/*
+ * Set the number of bytes of the last data request that the display has
+ * received (see ssd1306_getDataProgressOn). A new data request starts at 0.
+ */
+void ssd1306_mock_setDataProgress(uint8_t display, uint16_t bytes);
+
+#endif //BITLOOM_DRIVERS_SSD1306_MOCK_H
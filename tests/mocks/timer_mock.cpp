@@ -0,0 +1,38 @@
+/*
+ * Implementation of the timer mock module for the unit tests.
+ * The module implements a time source that is controlled by the test cases,
+ * so that the drivers can be tested without waiting for real time to pass.
+ *
+ * Copyright (c) 2021. BlueZephyr
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ *
+ */
+
+extern "C"
+{
+    // This module mocks the following interface
+    #include "hal/timer.h"
+    #include "timer_mock.h"
+}
+
+static struct timer_mock_t
+{
+    uint32_t time;
+} self;
+
+void timer_mock_setTime(uint32_t time)
+{
+    self.time = time;
+}
+
+void timer_mock_advanceTime(uint32_t milliseconds)
+{
+    self.time += milliseconds;
+}
+
+uint32_t timer_getMilliseconds(void)
+{
+    return self.time;
+}
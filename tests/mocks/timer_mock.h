@@ -0,0 +1,29 @@
+/*
+ * Implementation of the timer mock module for the unit tests.
+ * The module implements a time source that is controlled by the test cases,
+ * so that the drivers can be tested without waiting for real time to pass.
+ *
+ * Copyright (c) 2021. BlueZephyr
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ *
+ */
+
+#ifndef BITLOOM_DRIVERS_TIMER_MOCK_H
+#define BITLOOM_DRIVERS_TIMER_MOCK_H
+
+#include <stdint.h>
+#include "hal/timer.h"
+
+/*
+ * Set the time (in milliseconds) returned by the time source.
+ */
+void timer_mock_setTime(uint32_t time);
+
+/*
+ * Move the time forward.
+ */
+void timer_mock_advanceTime(uint32_t milliseconds);
+
+#endif //BITLOOM_DRIVERS_TIMER_MOCK_H
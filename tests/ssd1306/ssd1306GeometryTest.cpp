@@ -0,0 +1,138 @@
+/*
+ * Unit tests for the SSD1306 BitLoom driver on a panel that is smaller than the
+ * display RAM (72x40 pixels, connected from column 28).
+ *
+ * Copyright (c) 2021. BlueZephyr
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ *
+ */
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTestExt/MockSupport.h>
+
+extern "C"
+{
+    #include "ssd1306.h"
+    #include "ssd1306_defines.h"
+    #include "config/ssd1306_config.h"
+    #include "hal/i2c.h"
+    #include "i2c_mock.h"
+    #include "timer_mock.h"
+    #include "i2c_arbiter.h"
+}
+
+/*
+ * Defines for the test cases.
+ */
+#define SSD_TASK_ID                                          1
+
+
+TEST_GROUP(ssd1306_geometry)
+{
+    // Output parameters
+    enum ssd1306_result_t ssd1306OpResult;
+    enum i2c_op_result_t i2cOpResult;
+    uint8_t data[2] = {1, 2};
+
+    void setup() override
+    {
+        i2c_arbiter_init();
+        ssd1306_init(SSD_TASK_ID);
+    }
+
+    void teardown() override
+    {
+        mock().checkExpectations();
+        mock().clear();
+    }
+
+    void expectI2CTransfer(uint8_t control, const uint8_t *buffer, uint16_t length)
+    {
+        i2cOpResult = i2c_operation_ok;
+        mock().expectOneCall("i2c_masterTransmitRegister").
+                withParameter("address", SSD1306_I2C_SLAVE_ADDRESS).
+                withParameter("reg", control).
+                withParameter("length", length).
+                withMemoryBufferParameter("buffer", buffer, length).
+                withOutputParameterReturning("result", &i2cOpResult, sizeof(i2cOpResult)).
+                andReturnValue(i2c_request_ok);
+    }
+
+    void sendAndCheckResultOk()
+    {
+        CHECK_EQUAL(ssd1306_request_ok, ssd1306_sendGraphicsData(data, sizeof(data), &ssd1306OpResult));
+        ssd1306_run();
+        CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+    }
+};
+
+/********************************************************************
+ * TEST CASES
+ ********************************************************************/
+TEST(ssd1306_geometry, init_display_sets_the_multiplex_ratio_to_the_panel_height)
+{
+    const uint8_t initSequence[] =
+    {
+        SSD1306_SET_MULTIPLEX_RATIO, 39,
+        SSD1306_SET_DISPLAY_OFFSET, SSD1306_DEFAULT_DISPLAY_OFFSET,
+        SSD1306_SET_DISPLAY_START_LINE | SSD1306_DEFAULT_DISPLAY_STARTLINE,
+        SSD1306_SEGMENT_REMAP_127,
+        SSD1306_SET_COM_OUTPUT_SCAN_DIRECTION_REMAPPED,
+        SSD1306_SET_COM_PINS_HARDWARE_CONFIGURATION, 0x12,
+        SSD1306_SET_CONTRAST, SSD1306_DEFAULT_CONTRAST,
+        SSD1306_SET_USE_PIXELS_FROM_RAM,
+        SSD1306_SET_NORMAL_DISPLAY,
+        SSD1306_SET_CLOCK_DIVIDER_AND_OSCILLATOR, 0x80,
+        SSD1306_CHARGE_PUMP_SETTING, SSD1306_CHARGE_PUMP_ENABLE,
+        SSD1306_SET_MEMORY_ADDRESSING_MODE, SSD1306_PAGE_ADDRESSING_MODE,
+        SSD1306_DISPLAY_ON
+    };
+    expectI2CTransfer(SSD1306_COMMAND_SINGLE, initSequence, sizeof(initSequence));
+
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_initDisplay(&ssd1306OpResult));
+    timer_mock_advanceTime(SSD1306_POWER_ON_DELAY_MS);
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+}
+
+TEST(ssd1306_geometry, default_window_covers_the_panel_from_the_column_offset)
+{
+    const uint8_t windowCommands[] = {SSD1306_SET_MEMORY_ADDRESSING_MODE, SSD1306_HORIZONTAL_ADDRESSING_MODE,
+                                      SSD1306_SET_COLUMN_ADDRESS, 28, 99,
+                                      SSD1306_SET_PAGE_ADDRESS, 0, 4};
+
+    expectI2CTransfer(SSD1306_COMMAND_SINGLE, windowCommands, sizeof(windowCommands));
+    expectI2CTransfer(SSD1306_DATA_SINGLE, data, sizeof(data));
+
+    // Columns outside of the panel are ignored
+    ssd1306_setColumnAddress(72, 72);
+    ssd1306_setMemoryAddressingMode(ssd1306_addressing_horizontal);
+    sendAndCheckResultOk();
+}
+
+TEST(ssd1306_geometry, page_header_moves_the_ram_pointer_to_the_column_after_the_offset)
+{
+    const uint8_t modeCommand[] = {SSD1306_SET_MEMORY_ADDRESSING_MODE, SSD1306_PAGE_ADDRESSING_MODE};
+    const uint8_t pageHeader[] = {SSD1306_SET_PAGE_START | 1,
+                                  SSD1306_SET_LOWER_COLUMN_START | 0x0, SSD1306_SET_HIGHER_COLUMN_START | 0x2};
+
+    expectI2CTransfer(SSD1306_COMMAND_SINGLE, modeCommand, sizeof(modeCommand));
+    expectI2CTransfer(SSD1306_COMMAND_SINGLE, pageHeader, sizeof(pageHeader));
+    expectI2CTransfer(SSD1306_DATA_SINGLE, data, sizeof(data));
+
+    ssd1306_setMemoryAddressingMode(ssd1306_addressing_page);
+    ssd1306_setColumnAddress(4, 5);
+    ssd1306_setPageAddress(1, 1);
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_sendGraphicsData(data, sizeof(data), &ssd1306OpResult));
+    for (int i=0; i<3; i++)
+    {
+        ssd1306_run();
+    }
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+}
+
+int main(int ac, char** av)
+{
+    return CommandLineTestRunner::RunAllTests(ac, av);
+}
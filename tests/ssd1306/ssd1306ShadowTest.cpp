@@ -0,0 +1,246 @@
+/*
+ * Unit tests for the SSD1306 BitLoom driver with the display RAM shadow
+ * (SSD1306_GDDRAM_SHADOW) enabled.
+ *
+ * Copyright (c) 2021. BlueZephyr
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ *
+ */
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTestExt/MockSupport.h>
+
+extern "C"
+{
+    #include "ssd1306.h"
+    #include "ssd1306_defines.h"
+    #include "config/ssd1306_config.h"
+    #include "hal/i2c.h"
+    #include "i2c_mock.h"
+    #include "i2c_arbiter.h"
+    #include "timer_mock.h"
+}
+
+/*
+ * Defines for the test cases.
+ */
+#define SSD_TASK_ID                                          1
+
+
+TEST_GROUP(ssd1306_gddram_shadow)
+{
+    // Output parameters
+    enum ssd1306_result_t ssd1306OpResult;
+    enum i2c_op_result_t i2cOpResult;
+    uint8_t data[16];
+
+    void setup() override
+    {
+        i2c_arbiter_init();
+        ssd1306_init(SSD_TASK_ID);
+        for (uint8_t i=0; i<sizeof(data); i++)
+        {
+            data[i] = i + 1;
+        }
+    }
+
+    void teardown() override
+    {
+        mock().checkExpectations();
+        mock().clear();
+    }
+
+    void expectI2CTransfer(uint8_t control, const uint8_t *buffer, uint16_t length)
+    {
+        i2cOpResult = i2c_operation_ok;
+        mock().expectOneCall("i2c_masterTransmitRegister").
+                withParameter("address", SSD1306_I2C_SLAVE_ADDRESS).
+                withParameter("reg", control).
+                withParameter("length", length).
+                withMemoryBufferParameter("buffer", buffer, length).
+                withOutputParameterReturning("result", &i2cOpResult, sizeof(i2cOpResult)).
+                andReturnValue(i2c_request_ok);
+    }
+
+    void sendAndCheckResultOk()
+    {
+        CHECK_EQUAL(ssd1306_request_ok, ssd1306_sendGraphicsData(data, sizeof(data), &ssd1306OpResult));
+        for (int i=0; i<4; i++)
+        {
+            ssd1306_run();
+        }
+        CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+    }
+
+    // Send the data to a window of one page and 16 columns in horizontal mode
+    void sendFirstFrame()
+    {
+        const uint8_t windowCommands[] = {SSD1306_SET_MEMORY_ADDRESSING_MODE, SSD1306_HORIZONTAL_ADDRESSING_MODE,
+                                          SSD1306_SET_COLUMN_ADDRESS, 0, 15,
+                                          SSD1306_SET_PAGE_ADDRESS, 0, 0};
+
+        expectI2CTransfer(SSD1306_COMMAND_SINGLE, windowCommands, sizeof(windowCommands));
+        expectI2CTransfer(SSD1306_DATA_SINGLE, data, sizeof(data));
+        ssd1306_setMemoryAddressingMode(ssd1306_addressing_horizontal);
+        ssd1306_setColumnAddress(0, 15);
+        ssd1306_setPageAddress(0, 0);
+        sendAndCheckResultOk();
+        mock().checkExpectations();
+    }
+};
+
+/********************************************************************
+ * TEST CASES
+ ********************************************************************/
+TEST(ssd1306_gddram_shadow, data_that_the_display_holds_is_not_sent_again)
+{
+    sendFirstFrame();
+    sendAndCheckResultOk();
+}
+
+TEST(ssd1306_gddram_shadow, changed_run_is_sent_in_its_own_window)
+{
+    // The page is the same as in the previous window
+    const uint8_t runWindow[] = {SSD1306_SET_COLUMN_ADDRESS, 12, 12};
+
+    sendFirstFrame();
+    data[12] = 0xFF;
+    expectI2CTransfer(SSD1306_COMMAND_SINGLE, runWindow, sizeof(runWindow));
+    expectI2CTransfer(SSD1306_DATA_SINGLE, data + 12, 1);
+    sendAndCheckResultOk();
+}
+
+TEST(ssd1306_gddram_shadow, short_unchanged_gap_is_sent_instead_of_a_new_window)
+{
+    const uint8_t runWindow[] = {SSD1306_SET_COLUMN_ADDRESS, 2, 4};
+
+    sendFirstFrame();
+    data[2] = 0xFF;
+    data[4] = 0xFF;
+    expectI2CTransfer(SSD1306_COMMAND_SINGLE, runWindow, sizeof(runWindow));
+    expectI2CTransfer(SSD1306_DATA_SINGLE, data + 2, 3);
+    sendAndCheckResultOk();
+}
+
+TEST(ssd1306_gddram_shadow, long_unchanged_gap_is_skipped)
+{
+    const uint8_t firstRunWindow[] = {SSD1306_SET_COLUMN_ADDRESS, 0, 0};
+    const uint8_t secondRunWindow[] = {SSD1306_SET_COLUMN_ADDRESS, 15, 15};
+
+    sendFirstFrame();
+    data[0] = 0xFF;
+    data[15] = 0xFF;
+    expectI2CTransfer(SSD1306_COMMAND_SINGLE, firstRunWindow, sizeof(firstRunWindow));
+    expectI2CTransfer(SSD1306_DATA_SINGLE, data, 1);
+    expectI2CTransfer(SSD1306_COMMAND_SINGLE, secondRunWindow, sizeof(secondRunWindow));
+    expectI2CTransfer(SSD1306_DATA_SINGLE, data + 15, 1);
+    sendAndCheckResultOk();
+}
+
+TEST(ssd1306_gddram_shadow, skipped_data_counts_as_received)
+{
+    const uint8_t runWindow[] = {SSD1306_SET_COLUMN_ADDRESS, 15, 15};
+
+    sendFirstFrame();
+    data[15] = 0xFF;
+    expectI2CTransfer(SSD1306_COMMAND_SINGLE, runWindow, sizeof(runWindow));
+    expectI2CTransfer(SSD1306_DATA_SINGLE, data + 15, 1);
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_sendGraphicsData(data, sizeof(data), &ssd1306OpResult));
+    CHECK_EQUAL(0, ssd1306_getDataProgress());
+
+    // The unchanged data has been skipped while the window of the changed byte
+    // is sent
+    i2cOpResult = i2c_operation_processing;
+    ssd1306_run();
+    CHECK_EQUAL(sizeof(data) - 1, ssd1306_getDataProgress());
+    i2cOpResult = i2c_operation_ok;
+    i2c_mock_updateI2cOpResult(i2c_operation_ok);
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+    CHECK_EQUAL(sizeof(data), ssd1306_getDataProgress());
+}
+
+TEST(ssd1306_gddram_shadow, changed_run_is_sent_with_a_page_header_in_page_mode)
+{
+    const uint8_t firstHeader[] = {SSD1306_SET_MEMORY_ADDRESSING_MODE, SSD1306_PAGE_ADDRESSING_MODE,
+                                   SSD1306_SET_PAGE_START | 1,
+                                   SSD1306_SET_LOWER_COLUMN_START, SSD1306_SET_HIGHER_COLUMN_START};
+    const uint8_t runHeader[] = {SSD1306_SET_LOWER_COLUMN_START | 0xA, SSD1306_SET_HIGHER_COLUMN_START};
+
+    expectI2CTransfer(SSD1306_COMMAND_SINGLE, firstHeader, sizeof(firstHeader));
+    expectI2CTransfer(SSD1306_DATA_SINGLE, data, sizeof(data));
+    ssd1306_setColumnAddress(0, 15);
+    ssd1306_setPageAddress(1, 1);
+    sendAndCheckResultOk();
+    mock().checkExpectations();
+
+    data[10] = 0xFF;
+    expectI2CTransfer(SSD1306_COMMAND_SINGLE, runHeader, sizeof(runHeader));
+    expectI2CTransfer(SSD1306_DATA_SINGLE, data + 10, 1);
+    sendAndCheckResultOk();
+}
+
+TEST(ssd1306_gddram_shadow, shadow_is_kept_if_the_scroll_is_already_active)
+{
+    enum ssd1306_result_t scrollOpResult;
+    const uint8_t activateCommand[] = {SSD1306_ACTIVATE_SCROLL};
+
+    expectI2CTransfer(SSD1306_COMMAND_SINGLE, activateCommand, sizeof(activateCommand));
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_activateScroll(&scrollOpResult));
+    ssd1306_run();
+    sendFirstFrame();
+
+    // The command is not sent again, and the data is not sent again
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_activateScroll(&scrollOpResult));
+    CHECK_EQUAL(ssd1306_result_ok, scrollOpResult);
+    sendAndCheckResultOk();
+}
+
+TEST(ssd1306_gddram_shadow, shadow_is_kept_if_the_scroll_request_is_rejected)
+{
+    enum ssd1306_result_t contrastOpResult[SSD1306_COMMAND_QUEUE_SIZE];
+    enum ssd1306_result_t scrollOpResult;
+    uint8_t contrastCommands[2 * SSD1306_COMMAND_QUEUE_SIZE];
+
+    sendFirstFrame();
+
+    // Fill the command queue
+    for (uint8_t i=0; i<SSD1306_COMMAND_QUEUE_SIZE; i++)
+    {
+        contrastCommands[2 * i] = SSD1306_SET_CONTRAST;
+        contrastCommands[2 * i + 1] = i;
+        CHECK_EQUAL(ssd1306_request_ok, ssd1306_setContrast(i, &contrastOpResult[i]));
+    }
+    CHECK_EQUAL(ssd1306_request_busy, ssd1306_activateScroll(&scrollOpResult));
+    expectI2CTransfer(SSD1306_COMMAND_SINGLE, contrastCommands, sizeof(contrastCommands));
+    ssd1306_run();
+    mock().checkExpectations();
+
+    // The display RAM is still known, so the data is not sent again
+    sendAndCheckResultOk();
+}
+
+TEST(ssd1306_gddram_shadow, whole_frame_is_sent_again_after_a_new_init)
+{
+    sendFirstFrame();
+
+    // The display RAM is not known after the init, e.g. after a reset
+    mock().expectOneCall("i2c_masterTransmitRegister").ignoreOtherParameters().andReturnValue(i2c_request_ok);
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_initDisplay(&ssd1306OpResult));
+    timer_mock_advanceTime(SSD1306_POWER_ON_DELAY_MS);
+    ssd1306_run();
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+    mock().checkExpectations();
+
+    sendFirstFrame();
+}
+
+/********************************************************************
+ * TEST RUNNER
+ ********************************************************************/
+int main(int ac, char** av)
+{
+    return CommandLineTestRunner::RunAllTests(ac, av);
+}
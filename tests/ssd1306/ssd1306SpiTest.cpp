@@ -0,0 +1,220 @@
+/*
+ * Unit tests for the SSD1306 BitLoom driver using the SPI bus.
+ *
+ * Copyright (c) 2021. BlueZephyr
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ *
+ */
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTestExt/MockSupport.h>
+
+extern "C"
+{
+    #include "ssd1306.h"
+    #include "ssd1306_defines.h"
+    #include "config/ssd1306_config.h"
+    #include "hal/spi.h"
+    #include "spi_mock.h"
+}
+
+/*
+ * Defines for the test cases.
+ */
+#define SSD_TASK_ID                                          1
+
+/*
+ * Mock of the D/C line function that the application provides
+ */
+void ssd1306_setDataCommandLine(bool data)
+{
+    mock().actualCall("ssd1306_setDataCommandLine").withParameter("data", data);
+}
+
+TEST_GROUP(ssd1306_spi)
+{
+    // Output parameters
+    enum ssd1306_result_t ssd1306OpResult;
+    enum spi_op_result_t spiOpResult;
+
+    void setup() override
+    {
+        ssd1306_init(SSD_TASK_ID);
+    }
+
+    void teardown() override
+    {
+        mock().checkExpectations();
+        mock().clear();
+    }
+
+    void expectSpiTransfer(bool data, const uint8_t *buffer, uint16_t length)
+    {
+        spiOpResult = spi_operation_ok;
+        mock().expectOneCall("ssd1306_setDataCommandLine").withParameter("data", data);
+        mock().expectOneCall("spi_masterTransmit").
+                withParameter("device", SSD1306_SPI_DEVICE).
+                withParameter("length", length).
+                withMemoryBufferParameter("buffer", buffer, length).
+                withOutputParameterReturning("result", &spiOpResult, sizeof(spiOpResult)).
+                andReturnValue(spi_request_ok);
+    }
+};
+
+/********************************************************************
+ * TEST CASES
+ ********************************************************************/
+TEST(ssd1306_spi, command_is_sent_with_dc_line_low)
+{
+    const uint8_t command[] = {SSD1306_SET_CONTRAST, 0x20};
+
+    expectSpiTransfer(false, command, sizeof(command));
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_setContrast(0x20, &ssd1306OpResult));
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+}
+
+TEST(ssd1306_spi, queued_commands_are_sent_in_one_transfer)
+{
+    enum ssd1306_result_t secondOpResult;
+    const uint8_t commands[] = {SSD1306_SET_INVERTED_DISPLAY, SSD1306_DISPLAY_ON};
+
+    expectSpiTransfer(false, commands, sizeof(commands));
+    (void)ssd1306_setInvertedDisplay(&ssd1306OpResult);
+    (void)ssd1306_setDisplayOn(&secondOpResult);
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+    CHECK_EQUAL(ssd1306_result_ok, secondOpResult);
+}
+
+TEST(ssd1306_spi, command_waits_until_spi_transfer_is_done)
+{
+    const uint8_t command[] = {SSD1306_SET_NORMAL_DISPLAY};
+
+    spiOpResult = spi_operation_processing;
+    mock().expectOneCall("ssd1306_setDataCommandLine").withParameter("data", false);
+    mock().expectOneCall("spi_masterTransmit").
+            withParameter("device", SSD1306_SPI_DEVICE).
+            withParameter("length", sizeof(command)).
+            withMemoryBufferParameter("buffer", command, sizeof(command)).
+            withOutputParameterReturning("result", &spiOpResult, sizeof(spiOpResult)).
+            andReturnValue(spi_request_ok);
+
+    (void)ssd1306_setNormalDisplay(&ssd1306OpResult);
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_processing, ssd1306OpResult);
+    spi_mock_updateSpiOpResult(spi_operation_ok);
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+}
+
+TEST(ssd1306_spi, graphics_data_is_sent_with_dc_line_high)
+{
+    uint8_t data[] = {1, 2, 3, 4};
+    const uint8_t windowCommands[] = {SSD1306_SET_MEMORY_ADDRESSING_MODE, SSD1306_HORIZONTAL_ADDRESSING_MODE,
+                                      SSD1306_SET_COLUMN_ADDRESS, 0, 127,
+                                      SSD1306_SET_PAGE_ADDRESS, 0, 7};
+
+    expectSpiTransfer(false, windowCommands, sizeof(windowCommands));
+    expectSpiTransfer(true, data, sizeof(data));
+
+    ssd1306_setMemoryAddressingMode(ssd1306_addressing_horizontal);
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_sendGraphicsData(data, sizeof(data), &ssd1306OpResult));
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+}
+
+TEST(ssd1306_spi, dc_line_is_not_changed_while_a_transfer_is_in_progress)
+{
+    enum ssd1306_result_t secondOpResult;
+    const uint8_t command[] = {SSD1306_SET_NORMAL_DISPLAY};
+    const uint8_t secondCommand[] = {SSD1306_SET_INVERTED_DISPLAY};
+
+    CHECK_EQUAL(1, ssd1306_addDisplay(SSD1306_SPI_DEVICE + 1, SSD1306_WIDTH, SSD1306_HEIGHT, 0));
+    (void)ssd1306_setNormalDisplay(&ssd1306OpResult);
+    CHECK_TRUE(ssd1306_selectDisplay(1));
+    (void)ssd1306_setInvertedDisplay(&secondOpResult);
+
+    // Only the first display may start its transfer
+    spiOpResult = spi_operation_processing;
+    mock().expectOneCall("ssd1306_setDataCommandLine").withParameter("data", false);
+    mock().expectOneCall("spi_masterTransmit").
+            withParameter("device", SSD1306_SPI_DEVICE).
+            withParameter("length", sizeof(command)).
+            withMemoryBufferParameter("buffer", command, sizeof(command)).
+            withOutputParameterReturning("result", &spiOpResult, sizeof(spiOpResult)).
+            andReturnValue(spi_request_ok);
+    ssd1306_run();
+    mock().checkExpectations();
+    CHECK_EQUAL(ssd1306_result_processing, secondOpResult);
+
+    // The second display starts when the transfer is done
+    spi_mock_updateSpiOpResult(spi_operation_ok);
+    spiOpResult = spi_operation_ok;
+    mock().expectOneCall("ssd1306_setDataCommandLine").withParameter("data", false);
+    mock().expectOneCall("spi_masterTransmit").
+            withParameter("device", SSD1306_SPI_DEVICE + 1).
+            withParameter("length", sizeof(secondCommand)).
+            withMemoryBufferParameter("buffer", secondCommand, sizeof(secondCommand)).
+            withOutputParameterReturning("result", &spiOpResult, sizeof(spiOpResult)).
+            andReturnValue(spi_request_ok);
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+    CHECK_EQUAL(ssd1306_result_ok, secondOpResult);
+}
+
+TEST(ssd1306_spi, displays_do_not_interleave_transfers_on_the_shared_dc_line)
+{
+    enum ssd1306_result_t secondOpResult;
+    enum spi_op_result_t dataOpResult = spi_operation_processing;
+    uint8_t data[] = {1, 2, 3, 4};
+    const uint8_t windowCommands[] = {SSD1306_SET_MEMORY_ADDRESSING_MODE, SSD1306_HORIZONTAL_ADDRESSING_MODE,
+                                      SSD1306_SET_COLUMN_ADDRESS, 0, 127,
+                                      SSD1306_SET_PAGE_ADDRESS, 0, 7};
+    const uint8_t command[] = {SSD1306_SET_CONTRAST, 0x20};
+
+    CHECK_EQUAL(1, ssd1306_addDisplay(SSD1306_SPI_DEVICE + 1, SSD1306_WIDTH, SSD1306_HEIGHT, 0));
+    expectSpiTransfer(false, windowCommands, sizeof(windowCommands));
+    ssd1306_setMemoryAddressingMode(ssd1306_addressing_horizontal);
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_sendGraphicsData(data, sizeof(data), &ssd1306OpResult));
+    mock().expectOneCall("ssd1306_setDataCommandLine").withParameter("data", true);
+    mock().expectOneCall("spi_masterTransmit").
+            withParameter("device", SSD1306_SPI_DEVICE).
+            withParameter("length", sizeof(data)).
+            withMemoryBufferParameter("buffer", data, sizeof(data)).
+            withOutputParameterReturning("result", &dataOpResult, sizeof(dataOpResult)).
+            andReturnValue(spi_request_ok);
+    ssd1306_run();
+
+    // The graphics data is on the bus when the second display gets a request
+    CHECK_TRUE(ssd1306_selectDisplay(1));
+    (void)ssd1306_setContrast(0x20, &secondOpResult);
+    ssd1306_run();
+    ssd1306_run();
+    mock().checkExpectations();
+    CHECK_EQUAL(ssd1306_result_processing, secondOpResult);
+
+    // The command is sent with the D/C line low when the data has been sent
+    spi_mock_updateSpiOpResult(spi_operation_ok);
+    spiOpResult = spi_operation_ok;
+    mock().expectOneCall("ssd1306_setDataCommandLine").withParameter("data", false);
+    mock().expectOneCall("spi_masterTransmit").
+            withParameter("device", SSD1306_SPI_DEVICE + 1).
+            withParameter("length", sizeof(command)).
+            withMemoryBufferParameter("buffer", command, sizeof(command)).
+            withOutputParameterReturning("result", &spiOpResult, sizeof(spiOpResult)).
+            andReturnValue(spi_request_ok);
+    ssd1306_run();
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+    CHECK_EQUAL(ssd1306_result_ok, secondOpResult);
+}
+
+/********************************************************************
+ * TEST RUNNER
+ ********************************************************************/
+int main(int ac, char** av)
+{
+    return CommandLineTestRunner::RunAllTests(ac, av);
+}
@@ -14,14 +14,19 @@ extern "C"
 {
     #include "ssd1306.h"
     #include "ssd1306_defines.h"
+    #include "config/ssd1306_config.h"
     #include "hal/i2c.h"
     #include "i2c_mock.h"
+    #include "timer_mock.h"
+    #include "i2c_arbiter.h"
 }
 
 /*
  * Defines for the test cases.
  */
 #define SSD_TASK_ID                                          1
+#define SSD_START_TIME                                     0xFFFFFFC0u
+#define SECOND_DISPLAY_ADDRESS                             0x7A
 
 
 TEST_GROUP(ssd1306_i2c)
@@ -34,6 +39,8 @@ TEST_GROUP(ssd1306_i2c)
 
     void setup() override
     {
+        timer_mock_setTime(SSD_START_TIME);
+        i2c_arbiter_init();
         ssd1306_init(SSD_TASK_ID);
     }
 
@@ -45,19 +52,67 @@ TEST_GROUP(ssd1306_i2c)
 
     void expectI2CCommandWithNoArgs(uint8_t command, enum i2c_request_t returnValue)
     {
-        buffer[0] = SSD1306_COMMAND_SINGLE;
-        buffer[1] = command;
+        buffer[0] = command;
         i2cOpResult = i2c_operation_processing;
-        mock().expectOneCall("i2c_masterTransmit").
+        mock().expectOneCall("i2c_masterTransmitRegister").
                 withParameter("address", SSD1306_I2C_SLAVE_ADDRESS).
+                withParameter("reg", SSD1306_COMMAND_SINGLE).
+                withParameter("length", 1).
+                withMemoryBufferParameter("buffer", buffer, 1).
+                withOutputParameterReturning("result", &i2cOpResult, sizeof(i2cOpResult)).
+                andReturnValue(returnValue);
+    }
+
+    void expectI2CCommandWithOneArg(uint8_t command, uint8_t argument, enum i2c_request_t returnValue)
+    {
+        buffer[0] = command;
+        buffer[1] = argument;
+        i2cOpResult = i2c_operation_ok;
+        mock().expectOneCall("i2c_masterTransmitRegister").
+                withParameter("address", SSD1306_I2C_SLAVE_ADDRESS).
+                withParameter("reg", SSD1306_COMMAND_SINGLE).
                 withParameter("length", 2).
                 withMemoryBufferParameter("buffer", buffer, 2).
                 withOutputParameterReturning("result", &i2cOpResult, sizeof(i2cOpResult)).
                 andReturnValue(returnValue);
     }
 
+    void expectI2CData(const uint8_t *data, uint16_t length)
+    {
+        i2cOpResult = i2c_operation_ok;
+        mock().expectOneCall("i2c_masterTransmitRegister").
+                withParameter("address", SSD1306_I2C_SLAVE_ADDRESS).
+                withParameter("reg", SSD1306_DATA_SINGLE).
+                withParameter("length", length).
+                withMemoryBufferParameter("buffer", data, length).
+                withOutputParameterReturning("result", &i2cOpResult, sizeof(i2cOpResult)).
+                andReturnValue(i2c_request_ok);
+    }
+
+    void expectI2CCommands(const uint8_t *commands, uint16_t length)
+    {
+        i2cOpResult = i2c_operation_ok;
+        mock().expectOneCall("i2c_masterTransmitRegister").
+                withParameter("address", SSD1306_I2C_SLAVE_ADDRESS).
+                withParameter("reg", SSD1306_COMMAND_SINGLE).
+                withParameter("length", length).
+                withMemoryBufferParameter("buffer", commands, length).
+                withOutputParameterReturning("result", &i2cOpResult, sizeof(i2cOpResult)).
+                andReturnValue(i2c_request_ok);
+    }
+
+    static void executeRunTimes(int times)
+    {
+        for(int i=0; i<times; i++)
+        {
+            ssd1306_run();
+        }
+    }
+
     void processAndCheckSSD1306ResultOk()
     {
+        ssd1306_run();
+        CHECK_EQUAL(ssd1306_result_processing, ssd1306OpResult);
         i2c_mock_updateI2cOpResult(i2c_operation_ok);
         ssd1306_run();
         CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
@@ -81,12 +136,700 @@ TEST(ssd1306_i2c, set_display_pixels_use_pixel_data_from_RAM)
     processAndCheckSSD1306ResultOk();
 }
 
-TEST(ssd1306_i2c, request_when_driver_is_processing_returns_busy)
+TEST(ssd1306_i2c, request_when_driver_is_processing_is_queued)
 {
+    enum ssd1306_result_t secondOpResult;
+
     expectI2CCommandWithNoArgs(SSD1306_SET_USE_PIXELS_FROM_RAM, i2c_request_ok);
+    expectI2CCommandWithNoArgs(SSD1306_SET_PIXELS_ENTIRE_DISPLAY_ON, i2c_request_ok);
     (void)ssd1306_setPixelsFromRAM(&ssd1306OpResult);
     ssd1306_run();
-    CHECK_EQUAL(ssd1306_request_busy, ssd1306_setAllPixelsActive(&ssd1306OpResult));
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_setAllPixelsActive(&secondOpResult));
+    CHECK_EQUAL(ssd1306_result_processing, secondOpResult);
+
+    i2c_mock_updateI2cOpResult(i2c_operation_ok);
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+    i2c_mock_updateI2cOpResult(i2c_operation_ok);
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, secondOpResult);
+}
+
+TEST(ssd1306_i2c, queued_commands_are_sent_in_one_transaction)
+{
+    enum ssd1306_result_t secondOpResult;
+    const uint8_t commands[] = {SSD1306_SET_CONTRAST, 0x20, SSD1306_SET_INVERTED_DISPLAY};
+
+    i2cOpResult = i2c_operation_ok;
+    mock().expectOneCall("i2c_masterTransmitRegister").
+            withParameter("address", SSD1306_I2C_SLAVE_ADDRESS).
+            withParameter("reg", SSD1306_COMMAND_SINGLE).
+            withParameter("length", sizeof(commands)).
+            withMemoryBufferParameter("buffer", commands, sizeof(commands)).
+            withOutputParameterReturning("result", &i2cOpResult, sizeof(i2cOpResult)).
+            andReturnValue(i2c_request_ok);
+
+    (void)ssd1306_setContrast(0x20, &ssd1306OpResult);
+    (void)ssd1306_setInvertedDisplay(&secondOpResult);
+    executeRunTimes(2);
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+    CHECK_EQUAL(ssd1306_result_ok, secondOpResult);
+}
+
+TEST(ssd1306_i2c, request_when_queue_is_full_returns_busy)
+{
+    for (uint8_t i=0; i<SSD1306_COMMAND_QUEUE_SIZE; i++)
+    {
+        CHECK_EQUAL(ssd1306_request_ok, ssd1306_setContrast(i, &ssd1306OpResult));
+    }
+    CHECK_EQUAL(ssd1306_request_busy, ssd1306_setContrast(0xFF, &ssd1306OpResult));
+}
+
+TEST(ssd1306_i2c, request_with_invalid_parameter_is_rejected)
+{
+    CHECK_EQUAL(ssd1306_request_invalid, ssd1306_setDisplayStartLine(SSD1306_DISPLAY_START_LINE_MAX + 1, &ssd1306OpResult));
+    CHECK_EQUAL(ssd1306_request_invalid, ssd1306_setMultiplexRatio(SSD1306_MUX_MIN_VALUE - 1, &ssd1306OpResult));
+    ssd1306_run();
+}
+
+TEST(ssd1306_i2c, init_display_sends_whole_sequence_in_one_transaction)
+{
+    const uint8_t initSequence[] =
+    {
+        SSD1306_SET_MULTIPLEX_RATIO, SSD1306_HEIGHT - 1,
+        SSD1306_SET_DISPLAY_OFFSET, SSD1306_DEFAULT_DISPLAY_OFFSET,
+        SSD1306_SET_DISPLAY_START_LINE | SSD1306_DEFAULT_DISPLAY_STARTLINE,
+        SSD1306_SEGMENT_REMAP_127,
+        SSD1306_SET_COM_OUTPUT_SCAN_DIRECTION_REMAPPED,
+        SSD1306_SET_COM_PINS_HARDWARE_CONFIGURATION, 0x12,
+        SSD1306_SET_CONTRAST, SSD1306_DEFAULT_CONTRAST,
+        SSD1306_SET_USE_PIXELS_FROM_RAM,
+        SSD1306_SET_NORMAL_DISPLAY,
+        SSD1306_SET_CLOCK_DIVIDER_AND_OSCILLATOR, 0x80,
+        SSD1306_CHARGE_PUMP_SETTING, SSD1306_CHARGE_PUMP_ENABLE,
+        SSD1306_SET_MEMORY_ADDRESSING_MODE, SSD1306_PAGE_ADDRESSING_MODE,
+        SSD1306_DISPLAY_ON
+    };
+    expectI2CCommands(initSequence, sizeof(initSequence));
+
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_initDisplay(&ssd1306OpResult));
+    executeRunTimes(5);
+    CHECK_EQUAL(1, mock().expectedCallsLeft());
+    timer_mock_advanceTime(SSD1306_POWER_ON_DELAY_MS);
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+}
+
+TEST(ssd1306_i2c, wakeup_time_is_the_end_of_the_power_on_delay)
+{
+    uint32_t wakeupTime;
+
+    CHECK_FALSE(ssd1306_getWakeupTime(&wakeupTime));
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_initDisplay(&ssd1306OpResult));
+    CHECK(ssd1306_getWakeupTime(&wakeupTime));
+    CHECK_EQUAL((uint32_t)(SSD_START_TIME + SSD1306_POWER_ON_DELAY_MS), wakeupTime);
+
+    // The time wraps during the delay
+    timer_mock_advanceTime(SSD1306_POWER_ON_DELAY_MS - 1);
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_processing, ssd1306OpResult);
+}
+
+TEST(ssd1306_i2c, requested_addressing_mode_is_sent_with_the_window_before_graphics_data)
+{
+    uint8_t data[] = {1, 2};
+    const uint8_t windowCommands[] = {SSD1306_SET_MEMORY_ADDRESSING_MODE, SSD1306_HORIZONTAL_ADDRESSING_MODE,
+                                      SSD1306_SET_COLUMN_ADDRESS, 0, 1,
+                                      SSD1306_SET_PAGE_ADDRESS, 0, 0};
+
+    mock().expectOneCall("i2c_masterTransmitRegister").ignoreOtherParameters().andReturnValue(i2c_request_ok);
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_initDisplay(&ssd1306OpResult));
+    timer_mock_advanceTime(SSD1306_POWER_ON_DELAY_MS);
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+
+    expectI2CCommands(windowCommands, sizeof(windowCommands));
+    expectI2CData(data, sizeof(data));
+    ssd1306_setMemoryAddressingMode(ssd1306_addressing_horizontal);
+    ssd1306_setColumnAddress(0, 1);
+    ssd1306_setPageAddress(0, 0);
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_sendGraphicsData(data, sizeof(data), &ssd1306OpResult));
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+}
+
+TEST(ssd1306_i2c, window_is_not_sent_again_when_previous_data_filled_the_window)
+{
+    uint8_t data[] = {1, 2, 3, 4};
+    const uint8_t windowCommands[] = {SSD1306_SET_MEMORY_ADDRESSING_MODE, SSD1306_HORIZONTAL_ADDRESSING_MODE,
+                                      SSD1306_SET_COLUMN_ADDRESS, 10, 11,
+                                      SSD1306_SET_PAGE_ADDRESS, 2, 3};
+
+    expectI2CCommands(windowCommands, sizeof(windowCommands));
+    expectI2CData(data, sizeof(data));
+    expectI2CData(data, sizeof(data));
+    ssd1306_setMemoryAddressingMode(ssd1306_addressing_horizontal);
+    ssd1306_setColumnAddress(10, 11);
+    ssd1306_setPageAddress(2, 3);
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_sendGraphicsData(data, sizeof(data), &ssd1306OpResult));
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+
+    // The RAM pointer has wrapped to the start of the same window
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_sendGraphicsData(data, sizeof(data), &ssd1306OpResult));
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+}
+
+TEST(ssd1306_i2c, window_is_sent_again_when_previous_data_did_not_fill_the_window)
+{
+    uint8_t data[] = {1, 2, 3};
+    const uint8_t windowCommands[] = {SSD1306_SET_MEMORY_ADDRESSING_MODE, SSD1306_HORIZONTAL_ADDRESSING_MODE,
+                                      SSD1306_SET_COLUMN_ADDRESS, 10, 11,
+                                      SSD1306_SET_PAGE_ADDRESS, 2, 3};
+    const uint8_t sameWindowCommands[] = {SSD1306_SET_COLUMN_ADDRESS, 10, 11,
+                                          SSD1306_SET_PAGE_ADDRESS, 2, 3};
+
+    expectI2CCommands(windowCommands, sizeof(windowCommands));
+    expectI2CData(data, sizeof(data));
+    expectI2CCommands(sameWindowCommands, sizeof(sameWindowCommands));
+    expectI2CData(data, sizeof(data));
+    ssd1306_setMemoryAddressingMode(ssd1306_addressing_horizontal);
+    ssd1306_setColumnAddress(10, 11);
+    ssd1306_setPageAddress(2, 3);
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_sendGraphicsData(data, sizeof(data), &ssd1306OpResult));
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_sendGraphicsData(data, sizeof(data), &ssd1306OpResult));
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+}
+
+TEST(ssd1306_i2c, setting_that_already_has_the_requested_value_is_not_sent)
+{
+    enum ssd1306_result_t secondOpResult;
+    const uint8_t command[] = {SSD1306_SET_CONTRAST, 0x20};
+
+    expectI2CCommands(command, sizeof(command));
+    (void)ssd1306_setContrast(0x20, &ssd1306OpResult);
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_setContrast(0x20, &secondOpResult));
+    CHECK_EQUAL(ssd1306_result_ok, secondOpResult);
+    ssd1306_run();
+}
+
+TEST(ssd1306_i2c, fade_and_zoom_are_sent_as_commands_without_graphics_data)
+{
+    enum ssd1306_result_t secondOpResult;
+    const uint8_t commands[] = {SSD1306_SET_FADE_OUT_AND_BLINKING, SSD1306_BLINKING_ENABLE | 0x03,
+                                SSD1306_SET_ZOOM_IN, SSD1306_ZOOM_IN_ENABLE};
+
+    expectI2CCommands(commands, sizeof(commands));
+    CHECK_EQUAL(ssd1306_request_invalid, ssd1306_setFadeOut(ssd1306_fade_out, 0x10, &ssd1306OpResult));
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_setFadeOut(ssd1306_fade_blink, 0x03, &ssd1306OpResult));
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_enableZoomIn(&secondOpResult));
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+    CHECK_EQUAL(ssd1306_result_ok, secondOpResult);
+
+    // The display already zooms in, so the command is not sent again
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_enableZoomIn(&secondOpResult));
+    CHECK_EQUAL(ssd1306_result_ok, secondOpResult);
+}
+
+TEST(ssd1306_i2c, orientation_is_set_with_segment_remap_and_com_scan_direction_in_one_command)
+{
+    enum ssd1306_result_t secondOpResult;
+    const uint8_t commands[] = {SSD1306_SEGMENT_REMAP_0, SSD1306_SET_COM_OUTPUT_SCAN_DIRECTION_NORMAL};
+
+    expectI2CCommands(commands, sizeof(commands));
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_setOrientation(ssd1306_orientation_rotated_180, &ssd1306OpResult));
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+
+    // Already rotated
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_setOrientation(ssd1306_orientation_rotated_180, &secondOpResult));
+    CHECK_EQUAL(ssd1306_result_ok, secondOpResult);
+    CHECK_EQUAL(ssd1306_request_invalid, ssd1306_setOrientation((enum ssd1306_orientation_t)4, &secondOpResult));
+    ssd1306_run();
+}
+
+TEST(ssd1306_i2c, command_completes_in_one_run_when_bus_is_free)
+{
+    i2cOpResult = i2c_operation_ok;
+    mock().expectOneCall("i2c_masterTransmitRegister").
+            ignoreOtherParameters().
+            withOutputParameterReturning("result", &i2cOpResult, sizeof(i2cOpResult)).
+            andReturnValue(i2c_request_ok);
+
+    (void)ssd1306_setContrast(0x20, &ssd1306OpResult);
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+}
+
+TEST(ssd1306_i2c, graphics_data_is_sent_in_one_run_when_bus_is_free)
+{
+    uint8_t data[] = {1, 2, 3, 4};
+    const uint8_t windowCommands[] = {SSD1306_SET_MEMORY_ADDRESSING_MODE, SSD1306_HORIZONTAL_ADDRESSING_MODE,
+                                      SSD1306_SET_COLUMN_ADDRESS, 0, 127,
+                                      SSD1306_SET_PAGE_ADDRESS, 0, 7};
+
+    expectI2CCommands(windowCommands, sizeof(windowCommands));
+    expectI2CData(data, sizeof(data));
+
+    ssd1306_setMemoryAddressingMode(ssd1306_addressing_horizontal);
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_sendGraphicsData(data, sizeof(data), &ssd1306OpResult));
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+}
+
+TEST(ssd1306_i2c, graphics_spans_are_sent_one_transfer_each_without_copy)
+{
+    const uint8_t firstLine[] = {1, 2, 3};
+    const uint8_t secondLine[] = {4, 5, 6};
+    const struct ssd1306_data_span_t spans[] =
+    {
+        {firstLine, sizeof(firstLine)},
+        {secondLine, 0},
+        {secondLine, sizeof(secondLine)}
+    };
+    const uint8_t modeCommand[] = {SSD1306_SET_MEMORY_ADDRESSING_MODE, SSD1306_PAGE_ADDRESSING_MODE};
+    const uint8_t pageHeader[] = {SSD1306_SET_PAGE_START | 0, SSD1306_SET_LOWER_COLUMN_START, SSD1306_SET_HIGHER_COLUMN_START};
+
+    expectI2CCommands(modeCommand, sizeof(modeCommand));
+    expectI2CCommands(pageHeader, sizeof(pageHeader));
+    i2cOpResult = i2c_operation_ok;
+    mock().expectOneCall("i2c_masterTransmitRegister").
+            withParameter("address", SSD1306_I2C_SLAVE_ADDRESS).
+            withParameter("reg", SSD1306_DATA_SINGLE).
+            withParameter("length", sizeof(firstLine)).
+            withMemoryBufferParameter("buffer", firstLine, sizeof(firstLine)).
+            withOutputParameterReturning("result", &i2cOpResult, sizeof(i2cOpResult)).
+            andReturnValue(i2c_request_ok);
+    mock().expectOneCall("i2c_masterTransmitRegister").
+            withParameter("address", SSD1306_I2C_SLAVE_ADDRESS).
+            withParameter("reg", SSD1306_DATA_SINGLE).
+            withParameter("length", sizeof(secondLine)).
+            withMemoryBufferParameter("buffer", secondLine, sizeof(secondLine)).
+            withOutputParameterReturning("result", &i2cOpResult, sizeof(i2cOpResult)).
+            andReturnValue(i2c_request_ok);
+
+    // Page addressing mode (default): one page header is sent instead of the
+    // window commands. The mode is sent since the display has not been initialized.
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_sendGraphicsSpans(spans, 3, &ssd1306OpResult));
+    executeRunTimes(2);
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+}
+
+TEST(ssd1306_i2c, large_graphics_data_is_sent_in_chunks_one_per_run)
+{
+    uint8_t data[SSD1306_DATA_CHUNK_SIZE + 4];
+    const uint8_t modeCommand[] = {SSD1306_SET_MEMORY_ADDRESSING_MODE, SSD1306_PAGE_ADDRESSING_MODE};
+    const uint8_t pageHeader[] = {SSD1306_SET_PAGE_START | 0, SSD1306_SET_LOWER_COLUMN_START, SSD1306_SET_HIGHER_COLUMN_START};
+
+    for (uint16_t i=0; i<sizeof(data); i++)
+    {
+        data[i] = (uint8_t)i;
+    }
+    expectI2CCommands(modeCommand, sizeof(modeCommand));
+    expectI2CCommands(pageHeader, sizeof(pageHeader));
+    i2cOpResult = i2c_operation_ok;
+    mock().expectOneCall("i2c_masterTransmitRegister").
+            withParameter("address", SSD1306_I2C_SLAVE_ADDRESS).
+            withParameter("reg", SSD1306_DATA_SINGLE).
+            withParameter("length", SSD1306_DATA_CHUNK_SIZE).
+            withMemoryBufferParameter("buffer", data, SSD1306_DATA_CHUNK_SIZE).
+            withOutputParameterReturning("result", &i2cOpResult, sizeof(i2cOpResult)).
+            andReturnValue(i2c_request_ok);
+    mock().expectOneCall("i2c_masterTransmitRegister").
+            withParameter("address", SSD1306_I2C_SLAVE_ADDRESS).
+            withParameter("reg", SSD1306_DATA_SINGLE).
+            withParameter("length", 4).
+            withMemoryBufferParameter("buffer", data + SSD1306_DATA_CHUNK_SIZE, 4).
+            withOutputParameterReturning("result", &i2cOpResult, sizeof(i2cOpResult)).
+            andReturnValue(i2c_request_ok);
+
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_sendGraphicsData(data, sizeof(data), &ssd1306OpResult));
+    ssd1306_run();
+    CHECK_EQUAL(1, mock().expectedCallsLeft());
+    CHECK_EQUAL(ssd1306_result_processing, ssd1306OpResult);
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+}
+
+TEST(ssd1306_i2c, data_progress_counts_the_data_that_the_display_has_received)
+{
+    uint8_t data[SSD1306_DATA_CHUNK_SIZE + 4] = {0};
+    const uint8_t modeCommand[] = {SSD1306_SET_MEMORY_ADDRESSING_MODE, SSD1306_PAGE_ADDRESSING_MODE};
+    const uint8_t pageHeader[] = {SSD1306_SET_PAGE_START | 0, SSD1306_SET_LOWER_COLUMN_START, SSD1306_SET_HIGHER_COLUMN_START};
+
+    expectI2CCommands(modeCommand, sizeof(modeCommand));
+    expectI2CCommands(pageHeader, sizeof(pageHeader));
+    expectI2CData(data, SSD1306_DATA_CHUNK_SIZE);
+    expectI2CData(data + SSD1306_DATA_CHUNK_SIZE, 4);
+
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_sendGraphicsData(data, sizeof(data), &ssd1306OpResult));
+    CHECK_EQUAL(0, ssd1306_getDataProgress());
+    ssd1306_run();
+    CHECK_EQUAL(SSD1306_DATA_CHUNK_SIZE, ssd1306_getDataProgress());
+
+    // The last chunk is not counted until the transfer is done
+    i2cOpResult = i2c_operation_processing;
+    ssd1306_run();
+    CHECK_EQUAL(SSD1306_DATA_CHUNK_SIZE, ssd1306_getDataProgress());
+    i2c_mock_updateI2cOpResult(i2c_operation_ok);
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+    CHECK_EQUAL(sizeof(data), ssd1306_getDataProgress());
+}
+
+TEST(ssd1306_i2c, command_requested_during_graphics_data_is_sent_after_the_last_chunk)
+{
+    uint8_t data[SSD1306_DATA_CHUNK_SIZE + 4] = {0};
+    enum ssd1306_result_t remapOpResult;
+    const uint8_t modeCommand[] = {SSD1306_SET_MEMORY_ADDRESSING_MODE, SSD1306_PAGE_ADDRESSING_MODE};
+    const uint8_t pageHeader[] = {SSD1306_SET_PAGE_START | 0, SSD1306_SET_LOWER_COLUMN_START, SSD1306_SET_HIGHER_COLUMN_START};
+    const uint8_t remapCommand[] = {SSD1306_SEGMENT_REMAP_0};
+
+    expectI2CCommands(modeCommand, sizeof(modeCommand));
+    expectI2CCommands(pageHeader, sizeof(pageHeader));
+    expectI2CData(data, SSD1306_DATA_CHUNK_SIZE);
+    expectI2CData(data + SSD1306_DATA_CHUNK_SIZE, 4);
+    expectI2CCommands(remapCommand, sizeof(remapCommand));
+
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_sendGraphicsData(data, sizeof(data), &ssd1306OpResult));
+    ssd1306_run();
+    CHECK_EQUAL(2, mock().expectedCallsLeft());
+
+    // The remap would mirror the rest of the frame. The transfers are ongoing
+    // until they are completed below.
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_setSegmentRemap_0(&remapOpResult));
+    i2cOpResult = i2c_operation_processing;
+    ssd1306_run();
+    CHECK_EQUAL(1, mock().expectedCallsLeft());
+
+    // The last chunk has been sent before the remap
+    i2c_mock_updateI2cOpResult(i2c_operation_ok);
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+    CHECK_EQUAL(ssd1306_result_processing, remapOpResult);
+    i2c_mock_updateI2cOpResult(i2c_operation_ok);
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, remapOpResult);
+}
+
+TEST(ssd1306_i2c, command_requested_before_graphics_data_is_sent_first)
+{
+    uint8_t data[] = {1, 2};
+    const uint8_t contrastCommand[] = {SSD1306_SET_CONTRAST, 0x10};
+    const uint8_t modeCommand[] = {SSD1306_SET_MEMORY_ADDRESSING_MODE, SSD1306_PAGE_ADDRESSING_MODE};
+    const uint8_t pageHeader[] = {SSD1306_SET_PAGE_START | 0, SSD1306_SET_LOWER_COLUMN_START, SSD1306_SET_HIGHER_COLUMN_START};
+    enum ssd1306_result_t contrastOpResult;
+
+    expectI2CCommands(contrastCommand, sizeof(contrastCommand));
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_setContrast(0x10, &contrastOpResult));
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_sendGraphicsData(data, sizeof(data), &ssd1306OpResult));
+    expectI2CCommands(modeCommand, sizeof(modeCommand));
+    expectI2CCommands(pageHeader, sizeof(pageHeader));
+    expectI2CData(data, sizeof(data));
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, contrastOpResult);
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+}
+
+TEST(ssd1306_i2c, page_mode_sends_a_short_header_and_the_columns_of_each_page)
+{
+    uint8_t data[] = {1, 2, 3, 4};
+    const uint8_t modeCommand[] = {SSD1306_SET_MEMORY_ADDRESSING_MODE, SSD1306_PAGE_ADDRESSING_MODE};
+    const uint8_t firstPageHeader[] = {SSD1306_SET_PAGE_START | 1,
+                                       SSD1306_SET_LOWER_COLUMN_START | 0x4, SSD1306_SET_HIGHER_COLUMN_START | 0x1};
+    const uint8_t secondPageHeader[] = {SSD1306_SET_PAGE_START | 2,
+                                        SSD1306_SET_LOWER_COLUMN_START | 0x4, SSD1306_SET_HIGHER_COLUMN_START | 0x1};
+
+    expectI2CCommands(modeCommand, sizeof(modeCommand));
+    expectI2CCommands(firstPageHeader, sizeof(firstPageHeader));
+    expectI2CData(data, 2);
+    expectI2CCommands(secondPageHeader, sizeof(secondPageHeader));
+    expectI2CData(data + 2, 2);
+
+    ssd1306_setMemoryAddressingMode(ssd1306_addressing_page);
+    ssd1306_setColumnAddress(20, 21);
+    ssd1306_setPageAddress(1, 2);
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_sendGraphicsData(data, sizeof(data), &ssd1306OpResult));
+    executeRunTimes(3);
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+}
+
+TEST(ssd1306_i2c, page_header_is_not_sent_when_ram_pointer_is_already_at_the_position)
+{
+    uint8_t data[] = {1, 2};
+    const uint8_t modeCommand[] = {SSD1306_SET_MEMORY_ADDRESSING_MODE, SSD1306_PAGE_ADDRESSING_MODE};
+    const uint8_t pageHeader[] = {SSD1306_SET_PAGE_START | 3,
+                                  SSD1306_SET_LOWER_COLUMN_START, SSD1306_SET_HIGHER_COLUMN_START};
+
+    expectI2CCommands(modeCommand, sizeof(modeCommand));
+    expectI2CCommands(pageHeader, sizeof(pageHeader));
+    expectI2CData(data, sizeof(data));
+    expectI2CData(data, sizeof(data));
+
+    ssd1306_setColumnAddress(0, 1);
+    ssd1306_setPageAddress(3, 3);
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_sendGraphicsData(data, sizeof(data), &ssd1306OpResult));
+    executeRunTimes(2);
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+
+    // The next columns on the same page follow directly after the previous data
+    ssd1306_setColumnAddress(2, 3);
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_sendGraphicsData(data, sizeof(data), &ssd1306OpResult));
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+}
+
+TEST(ssd1306_i2c, command_is_sent_again_after_backoff_when_display_did_not_respond)
+{
+    struct ssd1306_statistics_t statistics;
+
+    expectI2CCommandWithOneArg(SSD1306_SET_CONTRAST, 0x20, i2c_request_ok);
+    expectI2CCommandWithOneArg(SSD1306_SET_CONTRAST, 0x20, i2c_request_ok);
+    i2cOpResult = i2c_operation_processing;
+
+    (void)ssd1306_setContrast(0x20, &ssd1306OpResult);
+    ssd1306_run();
+    i2c_mock_updateI2cOpResult(i2c_operation_sla_error);
+    executeRunTimes(2);
+    CHECK_EQUAL(1, mock().expectedCallsLeft());
+    CHECK_EQUAL(ssd1306_result_processing, ssd1306OpResult);
+
+    ssd1306_run();
+    i2c_mock_updateI2cOpResult(i2c_operation_ok);
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+    ssd1306_getStatistics(&statistics);
+    CHECK_EQUAL(1, statistics.notStartedErrors);
+    CHECK_EQUAL(1, statistics.retries);
+}
+
+TEST(ssd1306_i2c, interrupted_graphics_data_is_resumed_at_the_start_of_the_page)
+{
+    uint8_t data[SSD1306_DATA_CHUNK_SIZE + 4];
+    const uint8_t windowCommands[] = {SSD1306_SET_MEMORY_ADDRESSING_MODE, SSD1306_HORIZONTAL_ADDRESSING_MODE,
+                                      SSD1306_SET_COLUMN_ADDRESS, 0, 127,
+                                      SSD1306_SET_PAGE_ADDRESS, 0, 7};
+    const uint8_t resumeCommands[] = {SSD1306_SET_COLUMN_ADDRESS, 0, 127,
+                                      SSD1306_SET_PAGE_ADDRESS, 0, 7};
+    struct ssd1306_statistics_t statistics;
+
+    for (uint16_t i=0; i<sizeof(data); i++)
+    {
+        data[i] = (uint8_t)i;
+    }
+    expectI2CCommands(windowCommands, sizeof(windowCommands));
+    expectI2CData(data, SSD1306_DATA_CHUNK_SIZE);
+    expectI2CCommands(resumeCommands, sizeof(resumeCommands));
+    expectI2CData(data, SSD1306_DATA_CHUNK_SIZE);
+    expectI2CData(data + SSD1306_DATA_CHUNK_SIZE, 4);
+    i2cOpResult = i2c_operation_processing;
+
+    ssd1306_setMemoryAddressingMode(ssd1306_addressing_horizontal);
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_sendGraphicsData(data, sizeof(data), &ssd1306OpResult));
+    ssd1306_run();
+    i2c_mock_updateI2cOpResult(i2c_operation_ok);
+    ssd1306_run();
+    i2c_mock_updateI2cOpResult(i2c_operation_write_error);
+    executeRunTimes(2);
+    CHECK_EQUAL(3, mock().expectedCallsLeft());
+
+    // The data is sent again from the start of the first page of the window
+    for (int i=0; i<3; i++)
+    {
+        ssd1306_run();
+        i2c_mock_updateI2cOpResult(i2c_operation_ok);
+    }
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+    ssd1306_getStatistics(&statistics);
+    CHECK_EQUAL(1, statistics.interruptedErrors);
+    CHECK_EQUAL(1, statistics.resumes);
+}
+
+TEST(ssd1306_i2c, request_fails_with_error_when_retry_limit_is_reached)
+{
+    struct ssd1306_statistics_t statistics;
+
+    i2cOpResult = i2c_operation_write_error;
+    mock().expectNCalls(SSD1306_RETRY_LIMIT + 1, "i2c_masterTransmitRegister").
+            ignoreOtherParameters().
+            withOutputParameterReturning("result", &i2cOpResult, sizeof(i2cOpResult)).
+            andReturnValue(i2c_request_ok);
+
+    (void)ssd1306_setContrast(0x20, &ssd1306OpResult);
+    executeRunTimes(20);
+    CHECK_EQUAL(ssd1306_result_error, ssd1306OpResult);
+    ssd1306_getStatistics(&statistics);
+    CHECK_EQUAL(SSD1306_RETRY_LIMIT + 1, statistics.interruptedErrors);
+    CHECK_EQUAL(SSD1306_RETRY_LIMIT, statistics.retries);
+    CHECK_EQUAL(1, statistics.failures);
+}
+
+TEST(ssd1306_i2c, horizontal_scroll_is_set_up_and_activated_in_one_transaction)
+{
+    enum ssd1306_result_t secondOpResult;
+    const uint8_t commands[] = {SSD1306_LEFT_HORIZONTAL_SCROLL, 0x00, 2, 0x07, 3, 0x00, 0xFF,
+                                SSD1306_ACTIVATE_SCROLL};
+
+    expectI2CCommands(commands, sizeof(commands));
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_setupHorizontalScroll(ssd1306_scroll_left, 2, 3,
+                                                                  ssd1306_scroll_2_frames, &ssd1306OpResult));
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_activateScroll(&secondOpResult));
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+    CHECK_EQUAL(ssd1306_result_ok, secondOpResult);
+
+    // Already active
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_activateScroll(&secondOpResult));
+    CHECK_EQUAL(ssd1306_result_ok, secondOpResult);
+    ssd1306_run();
+}
+
+TEST(ssd1306_i2c, vertical_and_horizontal_scroll_is_set_up_with_scroll_area)
+{
+    enum ssd1306_result_t secondOpResult;
+    const uint8_t commands[] = {SSD1306_SET_VERTICAL_SCROLL_AREA, 8, 56,
+                                SSD1306_VERTICAL_AND_RIGHT_HORIZONTAL_SCROLL, 0x00, 0, 0x00, 7, 1};
+
+    expectI2CCommands(commands, sizeof(commands));
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_setVerticalScrollArea(8, 56, &ssd1306OpResult));
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_setupVerticalAndHorizontalScroll(ssd1306_scroll_right, 0, 7,
+                                                                            ssd1306_scroll_5_frames, 1,
+                                                                            &secondOpResult));
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, secondOpResult);
+}
+
+TEST(ssd1306_i2c, scroll_with_invalid_parameter_is_rejected)
+{
+    CHECK_EQUAL(ssd1306_request_invalid, ssd1306_setupHorizontalScroll(ssd1306_scroll_right, 3, 2,
+                                                                       ssd1306_scroll_5_frames, &ssd1306OpResult));
+    CHECK_EQUAL(ssd1306_request_invalid, ssd1306_setupVerticalAndHorizontalScroll(ssd1306_scroll_right, 0, 8,
+                                                                                  ssd1306_scroll_5_frames, 1,
+                                                                                  &ssd1306OpResult));
+    CHECK_EQUAL(ssd1306_request_invalid, ssd1306_setupVerticalAndHorizontalScroll(ssd1306_scroll_right, 0, 7,
+                                                                                  ssd1306_scroll_5_frames, 64,
+                                                                                  &ssd1306OpResult));
+    CHECK_EQUAL(ssd1306_request_invalid, ssd1306_setVerticalScrollArea(8, 57, &ssd1306OpResult));
+    ssd1306_run();
+}
+
+TEST(ssd1306_i2c, requests_are_sent_to_the_selected_display)
+{
+    const uint8_t command[] = {SSD1306_SET_CONTRAST, 0x20};
+    uint8_t display = ssd1306_addDisplay(SECOND_DISPLAY_ADDRESS, 128, 32, 0);
+
+    CHECK_EQUAL(1, display);
+    i2cOpResult = i2c_operation_ok;
+    mock().expectOneCall("i2c_masterTransmitRegister").
+            withParameter("address", SECOND_DISPLAY_ADDRESS).
+            withParameter("reg", SSD1306_COMMAND_SINGLE).
+            withParameter("length", sizeof(command)).
+            withMemoryBufferParameter("buffer", command, sizeof(command)).
+            withOutputParameterReturning("result", &i2cOpResult, sizeof(i2cOpResult)).
+            andReturnValue(i2c_request_ok);
+
+    CHECK(ssd1306_selectDisplay(display));
+    CHECK_EQUAL(display, ssd1306_getSelectedDisplay());
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_setContrast(0x20, &ssd1306OpResult));
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+    CHECK_EQUAL(display, ssd1306_getSelectedDisplay());
+}
+
+TEST(ssd1306_i2c, request_to_a_given_display_keeps_the_selection)
+{
+    const uint8_t command[] = {SSD1306_SET_CONTRAST, 0x20};
+    uint8_t display = ssd1306_addDisplay(SECOND_DISPLAY_ADDRESS, 128, 32, 0);
+
+    i2cOpResult = i2c_operation_ok;
+    mock().expectOneCall("i2c_masterTransmitRegister").
+            withParameter("address", SECOND_DISPLAY_ADDRESS).
+            withParameter("reg", SSD1306_COMMAND_SINGLE).
+            withParameter("length", sizeof(command)).
+            withMemoryBufferParameter("buffer", command, sizeof(command)).
+            withOutputParameterReturning("result", &i2cOpResult, sizeof(i2cOpResult)).
+            andReturnValue(i2c_request_ok);
+
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_setContrastOn(display, 0x20, &ssd1306OpResult));
+    CHECK_EQUAL(0, ssd1306_getSelectedDisplay());
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+    CHECK_EQUAL(ssd1306_request_invalid, ssd1306_setContrastOn(display + 1, 0x20, &ssd1306OpResult));
+}
+
+TEST(ssd1306_i2c, transfers_to_two_displays_are_interleaved)
+{
+    enum ssd1306_result_t secondOpResult;
+
+    (void)ssd1306_addDisplay(SECOND_DISPLAY_ADDRESS, 128, 64, 0);
+    expectI2CCommandWithOneArg(SSD1306_SET_CONTRAST, 0x20, i2c_request_ok);
+    i2cOpResult = i2c_operation_processing;
+    mock().expectOneCall("i2c_masterTransmitRegister").
+            withParameter("address", SECOND_DISPLAY_ADDRESS).
+            ignoreOtherParameters().
+            andReturnValue(i2c_request_ok);
+
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_setContrast(0x20, &ssd1306OpResult));
+    CHECK(ssd1306_selectDisplay(1));
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_setContrast(0x30, &secondOpResult));
+
+    // The first display gets the bus, the second display waits for it
+    ssd1306_run();
+    CHECK_EQUAL(1, mock().expectedCallsLeft());
+    i2c_mock_updateI2cOpResult(i2c_operation_ok);
+
+    // The second display runs first in the next run
+    ssd1306_run();
+    CHECK_EQUAL(0, mock().expectedCallsLeft());
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+}
+
+TEST(ssd1306_i2c, displays_keep_the_bus_arbitration_when_the_driver_is_initialized_again)
+{
+    enum ssd1306_result_t secondOpResult;
+
+    // Each init takes the place on the bus of the previous one
+    for (uint8_t i=0; i<I2C_ARBITER_MAX_CLIENTS; i++)
+    {
+        ssd1306_init(SSD_TASK_ID);
+        (void)ssd1306_addDisplay(SECOND_DISPLAY_ADDRESS, 128, 64, 0);
+    }
+    expectI2CCommandWithOneArg(SSD1306_SET_CONTRAST, 0x20, i2c_request_ok);
+    i2cOpResult = i2c_operation_processing;
+    mock().expectOneCall("i2c_masterTransmitRegister").
+            withParameter("address", SECOND_DISPLAY_ADDRESS).
+            ignoreOtherParameters().
+            andReturnValue(i2c_request_ok);
+
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_setContrast(0x20, &ssd1306OpResult));
+    CHECK(ssd1306_selectDisplay(1));
+    CHECK_EQUAL(ssd1306_request_ok, ssd1306_setContrast(0x30, &secondOpResult));
+    ssd1306_run();
+    CHECK_EQUAL(1, mock().expectedCallsLeft());
+    i2c_mock_updateI2cOpResult(i2c_operation_ok);
+    ssd1306_run();
+    CHECK_EQUAL(ssd1306_result_ok, ssd1306OpResult);
+
+    // There is still room for the other clients of the bus
+    CHECK(i2c_arbiter_addClient(1) != I2C_ARBITER_NO_CLIENT);
+}
+
+TEST(ssd1306_i2c, display_is_not_added_when_geometry_is_invalid_or_no_more_displays_fit)
+{
+    CHECK_EQUAL(SSD1306_NO_DISPLAY, ssd1306_addDisplay(SECOND_DISPLAY_ADDRESS, 72, 40, 60));
+    CHECK_EQUAL(SSD1306_NO_DISPLAY, ssd1306_addDisplay(SECOND_DISPLAY_ADDRESS, 128, 36, 0));
+    CHECK_EQUAL(1, ssd1306_addDisplay(SECOND_DISPLAY_ADDRESS, 64, 48, 32));
+    CHECK_EQUAL(SSD1306_NO_DISPLAY, ssd1306_addDisplay(SECOND_DISPLAY_ADDRESS + 2, 64, 48, 32));
+    CHECK_FALSE(ssd1306_selectDisplay(2));
 }
 
 /********************************************************************
@@ -390,7 +390,7 @@ TEST(ssd1306_i2c, send_graphics_data_over_i2c)
 
 TEST(ssd1306_i2c, init_display)
 {
-    expect_i2c_command_one_arg(SSD1306_SET_MULTIPLEX_RATIO, SSD1306_DEFAULT_MUX_VALUE-1);
+    expect_i2c_command_one_arg(SSD1306_SET_MULTIPLEX_RATIO, SSD1306_HEIGHT-1);
     expect_i2c_command_one_arg(SSD1306_SET_DISPLAY_OFFSET, SSD1306_DEFAULT_DISPLAY_OFFSET);
     expect_i2c_command(SSD1306_SET_DISPLAY_START_LINE | SSD1306_DEFAULT_DISPLAY_STARTLINE);
     expect_i2c_command(SSD1306_SEGMENT_REMAP_0);